@@ -0,0 +1,160 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QJSON_HANDLERPARSER_H
+#define QJSON_HANDLERPARSER_H
+
+#include "streamreader.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QVariant>
+
+namespace QJson {
+
+  /**
+  * Parses a JSON document, reporting its content to \a handler as it is
+  * read. Handler is any class with these member functions. As Handler is
+  * a template parameter they are called directly and can be inlined,
+  * without the virtual calls of an abstract handler interface:
+  *
+  * \code
+  * struct Handler {
+  *   bool startObject();
+  *   bool endObject();
+  *   bool startArray();
+  *   bool endArray();
+  *   bool key(const QString& name);      // before the value of each object member
+  *   bool string(const QString& value);
+  *   bool integer(qlonglong value);
+  *   bool unsignedInteger(qulonglong value); // integers above the qlonglong range
+  *   bool real(double value);
+  *   bool boolean(bool value);
+  *   bool null();
+  * };
+  * \endcode
+  *
+  * Returning false from any of them stops parsing. This is a thin layer
+  * over \a reader, so the syntax accepted is the same as Parser's and the
+  * scanning costs are StreamReader's: each scalar token is still decoded
+  * into a QVariant, which the handler receives unwrapped, and each key
+  * into a QString, which is passed by reference without a further copy.
+  * What is saved compared to Parser is building the QVariantMap and
+  * QVariantList tree of the whole document.
+  *
+  * @param reader a reader which hasn't been read from yet
+  * @param handler receives the content of the document
+  * @param errorString if not null, set to the error message when parsing fails
+  * @param errorLine if not null, set to the line of the error when parsing fails
+  * @returns true if the whole document was read and accepted by the handler
+  */
+  template <class Handler>
+  bool parse(StreamReader& reader, Handler& handler, QString* errorString = 0, int* errorLine = 0)
+  {
+    // one entry for each open container, true for objects
+    QVarLengthArray<bool, 64> inObject;
+    bool accepted = true;
+
+    while (accepted) {
+      const StreamReader::TokenType type = reader.readNext();
+      if (type == StreamReader::EndDocument)
+        return true;
+      if (type == StreamReader::Invalid)
+        break;
+      if (type == StreamReader::StartDocument)
+        continue;
+
+      if (type == StreamReader::EndArray || type == StreamReader::EndObject) {
+        inObject.resize(inObject.size() - 1);
+        accepted = type == StreamReader::EndArray ? handler.endArray() : handler.endObject();
+        continue;
+      }
+
+      if (inObject.size() > 0 && inObject[inObject.size() - 1] && !handler.key(reader.name())) {
+        accepted = false;
+        continue;
+      }
+
+      switch (type) {
+        case StreamReader::StartArray:
+          inObject.append(false);
+          accepted = handler.startArray();
+          break;
+        case StreamReader::StartObject:
+          inObject.append(true);
+          accepted = handler.startObject();
+          break;
+        case StreamReader::String:
+          accepted = handler.string(reader.value().toString());
+          break;
+        case StreamReader::Number: {
+          const QVariant& value = reader.value();
+          // the scanner reads non negative integers as unsigned
+          if (value.userType() == QMetaType::LongLong)
+            accepted = handler.integer(value.toLongLong());
+          else if (value.userType() == QMetaType::ULongLong && value.toULongLong() > quint64(Q_INT64_C(0x7fffffffffffffff)))
+            accepted = handler.unsignedInteger(value.toULongLong());
+          else if (value.userType() == QMetaType::ULongLong)
+            accepted = handler.integer(value.toLongLong());
+          else
+            accepted = handler.real(value.toDouble());
+          break;
+        }
+        case StreamReader::Bool:
+          accepted = handler.boolean(reader.value().toBool());
+          break;
+        case StreamReader::Null:
+          accepted = handler.null();
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (errorString)
+      *errorString = accepted ? reader.errorString() : QString(QLatin1String("Parsing stopped by the handler"));
+    if (errorLine)
+      *errorLine = accepted ? reader.errorLine() : 0;
+    return false;
+  }
+
+  /**
+  * This is a method provided for convenience.
+  * @sa parse(StreamReader&, Handler&, QString*, int*)
+  */
+  template <class Handler>
+  bool parse(const QByteArray& data, Handler& handler, QString* errorString = 0, int* errorLine = 0)
+  {
+    StreamReader reader(data);
+    return parse(reader, handler, errorString, errorLine);
+  }
+
+  /**
+  * This is a method provided for convenience.
+  * @sa parse(StreamReader&, Handler&, QString*, int*)
+  */
+  template <class Handler>
+  bool parse(QIODevice* io, Handler& handler, QString* errorString = 0, int* errorLine = 0)
+  {
+    StreamReader reader(io);
+    return parse(reader, handler, errorString, errorLine);
+  }
+}
+
+#endif // QJSON_HANDLERPARSER_H
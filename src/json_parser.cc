@@ -448,7 +448,7 @@ namespace yy {
       {
           case 2:
 /* Line 670 of lalr1.cc  */
-#line 82 "json_parser.yy"
+#line 79 "json_parser.yy"
     {
               driver->m_result = (yysemantic_stack_[(1) - (1)]);
               qjsonDebug() << "json_parser - parsing finished";
@@ -457,13 +457,13 @@ namespace yy {
 
   case 3:
 /* Line 670 of lalr1.cc  */
-#line 87 "json_parser.yy"
+#line 84 "json_parser.yy"
     { (yyval) = (yysemantic_stack_[(1) - (1)]); }
     break;
 
   case 4:
 /* Line 670 of lalr1.cc  */
-#line 89 "json_parser.yy"
+#line 86 "json_parser.yy"
     {
             qCritical()<< "json_parser - syntax error found, "
                     << "forcing abort, Line" << (yyloc).begin.line << "Column" << (yyloc).begin.column;
@@ -473,43 +473,43 @@ namespace yy {
 
   case 5:
 /* Line 670 of lalr1.cc  */
-#line 95 "json_parser.yy"
+#line 92 "json_parser.yy"
     {
-          (yyval) = QVariant(QVariantMap());
+          driver->beginObject();
+          (yyval) = driver->endObject();
         }
     break;
 
   case 6:
 /* Line 670 of lalr1.cc  */
-#line 98 "json_parser.yy"
+#line 96 "json_parser.yy"
     {
-          QVariantMap* map = (yysemantic_stack_[(3) - (2)]).value<QVariantMap*>();
-          (yyval) = QVariant(*map);
-          delete map;
+          (yyval) = driver->endObject();
      }
     break;
 
   case 7:
 /* Line 670 of lalr1.cc  */
-#line 104 "json_parser.yy"
+#line 100 "json_parser.yy"
     {
-          QVariantMap* pair = new QVariantMap();
-          pair->insert((yysemantic_stack_[(3) - (1)]).toString(), (yysemantic_stack_[(3) - (3)]));
-          (yyval).setValue<QVariantMap* >(pair);
+          driver->beginObject();
+          if (!driver->insertMember((yysemantic_stack_[(3) - (1)]), (yysemantic_stack_[(3) - (3)]), (yylocation_stack_[(3) - (3)]).end.line))
+            YYABORT;
         }
     break;
 
   case 8:
 /* Line 670 of lalr1.cc  */
-#line 109 "json_parser.yy"
+#line 105 "json_parser.yy"
     {
-            (yyval).value<QVariantMap*>()->insert((yysemantic_stack_[(5) - (3)]).toString(), (yysemantic_stack_[(5) - (5)]));
+            if (!driver->insertMember((yysemantic_stack_[(5) - (3)]), (yysemantic_stack_[(5) - (5)]), (yylocation_stack_[(5) - (5)]).end.line))
+              YYABORT;
          }
     break;
 
   case 9:
 /* Line 670 of lalr1.cc  */
-#line 113 "json_parser.yy"
+#line 110 "json_parser.yy"
     {
           (yyval) = QVariant(QVariantList());
         }
@@ -517,29 +517,28 @@ namespace yy {
 
   case 10:
 /* Line 670 of lalr1.cc  */
-#line 116 "json_parser.yy"
-    { 
-          QVector<QVariant>* list = (yysemantic_stack_[(3) - (2)]).value<QVector<QVariant>* >();
-          (yyval) = QVariant(list->toList());
-          delete list;
+#line 113 "json_parser.yy"
+    {
+          (yyval) = driver->endArray();
         }
     break;
 
   case 11:
 /* Line 670 of lalr1.cc  */
-#line 122 "json_parser.yy"
+#line 117 "json_parser.yy"
     {
-          QVector<QVariant>* list = new QVector<QVariant>(1);
-          list->replace(0, (yysemantic_stack_[(1) - (1)]));
-          (yyval).setValue(list);
+          driver->beginArray();
+          if (!driver->appendElement((yysemantic_stack_[(1) - (1)]), (yylocation_stack_[(1) - (1)]).end.line))
+            YYABORT;
         }
     break;
 
   case 12:
 /* Line 670 of lalr1.cc  */
-#line 127 "json_parser.yy"
+#line 122 "json_parser.yy"
     {
-          (yyval).value<QVector<QVariant>* >()->append((yysemantic_stack_[(3) - (3)]));
+          if (!driver->appendElement((yysemantic_stack_[(3) - (3)]), (yylocation_stack_[(3) - (3)]).end.line))
+            YYABORT;
         }
     break;
 
@@ -1073,7 +1072,7 @@ namespace yy {
 /* Line 1141 of lalr1.cc  */
 #line 1075 "json_parser.cc"
 /* Line 1142 of lalr1.cc  */
-#line 139 "json_parser.yy"
+#line 135 "json_parser.yy"
 
 
 int yy::yylex(YYSTYPE *yylval, yy::location *yylloc, QJson::ParserPrivate* driver)
@@ -62,9 +62,6 @@
   }
 
   #define YYERROR_VERBOSE 1
-  
-  Q_DECLARE_METATYPE(QVector<QVariant>*)
-  Q_DECLARE_METATYPE(QVariantMap*)
 
 
 /* Line 33 of lalr1.cc  */
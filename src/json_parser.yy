@@ -42,9 +42,6 @@
   }
 
   #define YYERROR_VERBOSE 1
-  
-  Q_DECLARE_METATYPE(QVector<QVariant>*)
-  Q_DECLARE_METATYPE(QVariantMap*)
 }
 
 %parse-param { QJson::ParserPrivate* driver }
@@ -93,39 +90,38 @@ data: value { $$ = $1; }
           };
 
 object: CURLY_BRACKET_OPEN CURLY_BRACKET_CLOSE {
-          $$ = QVariant(QVariantMap());
+          driver->beginObject();
+          $$ = driver->endObject();
         }
      |  CURLY_BRACKET_OPEN members CURLY_BRACKET_CLOSE {
-          QVariantMap* map = $2.value<QVariantMap*>();
-          $$ = QVariant(*map);
-          delete map;
+          $$ = driver->endObject();
      };
 
 members: STRING COLON value {
-          QVariantMap* pair = new QVariantMap();
-          pair->insert($1.toString(), $3);
-          $$.setValue<QVariantMap* >(pair);
+          driver->beginObject();
+          if (!driver->insertMember($1, $3, @3.end.line))
+            YYABORT;
         }
       |  members COMMA STRING COLON value {
-            $$.value<QVariantMap*>()->insert($3.toString(), $5);
+            if (!driver->insertMember($3, $5, @5.end.line))
+              YYABORT;
          };
 
 array:  SQUARE_BRACKET_OPEN SQUARE_BRACKET_CLOSE {
           $$ = QVariant(QVariantList());
         }
-    |   SQUARE_BRACKET_OPEN values SQUARE_BRACKET_CLOSE { 
-          QVector<QVariant>* list = $2.value<QVector<QVariant>* >();
-          $$ = QVariant(list->toList());
-          delete list;
+    |   SQUARE_BRACKET_OPEN values SQUARE_BRACKET_CLOSE {
+          $$ = driver->endArray();
         };
 
 values: value {
-          QVector<QVariant>* list = new QVector<QVariant>(1);
-          list->replace(0, $1);
-          $$.setValue(list);
+          driver->beginArray();
+          if (!driver->appendElement($1, @1.end.line))
+            YYABORT;
         }
      |  values COMMA value {
-          $$.value<QVector<QVariant>* >()->append($3);
+          if (!driver->appendElement($3, @3.end.line))
+            YYABORT;
         };
 
 value: STRING
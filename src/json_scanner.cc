@@ -3157,6 +3157,10 @@ static yyconst yy_state_type yy_NUL_trans[87] =
   #define strtoull _strtoui64
   #endif
 
+  // fill the whole free part of the buffer on each read, its size is
+  // set by JSonScanner::setReadBufferSize()
+  #define YY_READ_BUF_SIZE (1 << 30)
+
   #define YY_USER_INIT if(m_allowSpecialNumbers) { \
     BEGIN(ALLOW_SPECIAL_NUMBERS); \
   }
@@ -3267,7 +3271,7 @@ YY_DECL
 	register char *yy_cp, *yy_bp;
 	register int yy_act;
     
-#line 48 "json_scanner.yy"
+#line 52 "json_scanner.yy"
 
 
  /* Whitespace */
@@ -3344,7 +3348,7 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 51 "json_scanner.yy"
+#line 55 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
               }
@@ -3352,15 +3356,20 @@ YY_RULE_SETUP
 case 2:
 /* rule 2 can match eol */
 YY_RULE_SETUP
-#line 55 "json_scanner.yy"
+#line 59 "json_scanner.yy"
 { 
-                m_yylloc->lines(yyleng);
+                int lines = 0;
+                for (int i = 0; i < yyleng; ++i) {
+                  if (yytext[i] == '\n' || i + 1 == yyleng || yytext[i + 1] != '\n')
+                    ++lines;
+                }
+                m_yylloc->lines(lines);
               }
 	YY_BREAK
 /* Special values */
 case 3:
 YY_RULE_SETUP
-#line 61 "json_scanner.yy"
+#line 70 "json_scanner.yy"
 { 
                 m_yylloc->columns(yyleng);
                 *m_yylval = QVariant(true);
@@ -3369,7 +3378,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 67 "json_scanner.yy"
+#line 76 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 *m_yylval = QVariant(false);
@@ -3378,7 +3387,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 73 "json_scanner.yy"
+#line 82 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 *m_yylval = QVariant();
@@ -3387,10 +3396,10 @@ YY_RULE_SETUP
 	YY_BREAK
 /* Numbers */
 case 6:
-#line 82 "json_scanner.yy"
+#line 91 "json_scanner.yy"
 case 7:
 YY_RULE_SETUP
-#line 82 "json_scanner.yy"
+#line 91 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 unsigned long long val = strtoull(yytext, NULL, 10);
@@ -3403,10 +3412,10 @@ YY_RULE_SETUP
               }
 	YY_BREAK
 case 8:
-#line 93 "json_scanner.yy"
+#line 102 "json_scanner.yy"
 case 9:
 YY_RULE_SETUP
-#line 93 "json_scanner.yy"
+#line 102 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 long long val = strtoll(yytext, NULL, 10);
@@ -3420,11 +3429,14 @@ YY_RULE_SETUP
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 103 "json_scanner.yy"
+#line 112 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
-                bool ok;
-                *m_yylval = QVariant(m_C_locale.toDouble(QLatin1String(yytext),&ok));
+                bool ok = true;
+                // when only validating, numbers which can't be out of range
+                // aren't converted at all
+                if (!m_validateOnly || !isInDoubleRange(yytext, yyleng))
+                  *m_yylval = QVariant(m_C_locale.toDouble(QLatin1String(yytext),&ok));
                 if (!ok) {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
                     // See QTBUG-71256
@@ -3439,7 +3451,7 @@ YY_RULE_SETUP
 /* Strings */              
 case 11:
 YY_RULE_SETUP
-#line 115 "json_scanner.yy"
+#line 127 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 BEGIN(QUOTMARK_OPEN);
@@ -3448,63 +3460,71 @@ YY_RULE_SETUP
 
 case 12:
 YY_RULE_SETUP
-#line 121 "json_scanner.yy"
+#line 133 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\""));
+                  if (!appendChar('"'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 125 "json_scanner.yy"
+#line 137 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\\"));
+                  if (!appendChar('\\'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 129 "json_scanner.yy"
+#line 142 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("/"));
+                  if (!appendChar('/'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 133 "json_scanner.yy"
+#line 147 "json_scanner.yy"
 {
-                   m_currentString.append(QLatin1String("\b"));
+                   if (!appendChar('\b'))
+                     return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 137 "json_scanner.yy"
+#line 152 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\f"));
+                  if (!appendChar('\f'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 141 "json_scanner.yy"
+#line 157 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\n"));
+                  if (!appendChar('\n'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 145 "json_scanner.yy"
+#line 162 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\r"));
+                  if (!appendChar('\r'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 149 "json_scanner.yy"
+#line 167 "json_scanner.yy"
 {
-                  m_currentString.append(QLatin1String("\t"));
+                  if (!appendChar('\t'))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 153 "json_scanner.yy"
+#line 172 "json_scanner.yy"
 {
                   BEGIN(HEX_OPEN);
                 }
@@ -3512,31 +3532,34 @@ YY_RULE_SETUP
 case 21:
 /* rule 21 can match eol */
 YY_RULE_SETUP
-#line 157 "json_scanner.yy"
+#line 177 "json_scanner.yy"
 {
-                  m_currentString.append(QString::fromUtf8(yytext));
+                  if (!appendString(yytext, yyleng))
+                    return yy::json_parser::token::INVALID;
                 }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 161 "json_scanner.yy"
+#line 181 "json_scanner.yy"
 {
                   // ignore
                 }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 165 "json_scanner.yy"
+#line 186 "json_scanner.yy"
 {
                   m_yylloc->columns(yyleng);
-                  *m_yylval = QVariant(m_currentString);
+                  if (!m_validateOnly)
+                    *m_yylval = QVariant(m_currentString);
                   m_currentString.clear();
+                  m_currentStringLength = 0;
                   BEGIN(INITIAL);
                   return yy::json_parser::token::STRING;
                 }
 	YY_BREAK
 case YY_STATE_EOF(QUOTMARK_OPEN):
-#line 173 "json_scanner.yy"
+#line 194 "json_scanner.yy"
 {
                   qCritical() << "Unterminated string";
                   m_yylloc->columns(yyleng);
@@ -3547,20 +3570,17 @@ case YY_STATE_EOF(QUOTMARK_OPEN):
 
 case 24:
 YY_RULE_SETUP
-#line 182 "json_scanner.yy"
+#line 205 "json_scanner.yy"
 {
-                    QString hexDigits = QString::fromUtf8(yytext, yyleng);
-                    bool ok;
-                    ushort hexDigit1 = hexDigits.left(2).toShort(&ok, 16);
-                    ushort hexDigit2 = hexDigits.right(2).toShort(&ok, 16);    
-                    m_currentString.append(QChar(hexDigit2, hexDigit1));
+                    if (!appendChar(static_cast<ushort>(strtoul(yytext, NULL, 16))))
+                      return yy::json_parser::token::INVALID;
                     BEGIN(QUOTMARK_OPEN);
                  }
 	YY_BREAK
 case 25:
 /* rule 25 can match eol */
 YY_RULE_SETUP
-#line 191 "json_scanner.yy"
+#line 215 "json_scanner.yy"
 {
                     qCritical() << "Invalid hex string";
                     m_yylloc->columns(yyleng);
@@ -3573,7 +3593,7 @@ YY_RULE_SETUP
 /* "Compound type" related tokens */              
 case 26:
 YY_RULE_SETUP
-#line 203 "json_scanner.yy"
+#line 223 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::COLON;
@@ -3581,7 +3601,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 208 "json_scanner.yy"
+#line 228 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::COMMA;
@@ -3589,7 +3609,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 213 "json_scanner.yy"
+#line 233 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::SQUARE_BRACKET_OPEN;
@@ -3597,7 +3617,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 218 "json_scanner.yy"
+#line 238 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::SQUARE_BRACKET_CLOSE;
@@ -3605,7 +3625,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 223 "json_scanner.yy"
+#line 243 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::CURLY_BRACKET_OPEN;
@@ -3613,7 +3633,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 228 "json_scanner.yy"
+#line 248 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::CURLY_BRACKET_CLOSE;
@@ -3623,7 +3643,7 @@ YY_RULE_SETUP
 
 case 32:
 YY_RULE_SETUP
-#line 236 "json_scanner.yy"
+#line 256 "json_scanner.yy"
 {
                   m_yylloc->columns(yyleng);
                   *m_yylval = QVariant(std::numeric_limits<double>::quiet_NaN());
@@ -3632,7 +3652,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 242 "json_scanner.yy"
+#line 262 "json_scanner.yy"
 {
                     m_yylloc->columns(yyleng);
                     *m_yylval = QVariant(std::numeric_limits<double>::infinity());
@@ -3641,7 +3661,7 @@ YY_RULE_SETUP
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 248 "json_scanner.yy"
+#line 268 "json_scanner.yy"
 {
                     m_yylloc->columns(yyleng);
                     *m_yylval = QVariant(-std::numeric_limits<double>::infinity());
@@ -3652,7 +3672,7 @@ YY_RULE_SETUP
 /* If all else fails */
 case 35:
 YY_RULE_SETUP
-#line 256 "json_scanner.yy"
+#line 276 "json_scanner.yy"
 {
                 m_yylloc->columns(yyleng);
                 return yy::json_parser::token::INVALID;
@@ -3661,12 +3681,12 @@ YY_RULE_SETUP
 case YY_STATE_EOF(INITIAL):
 case YY_STATE_EOF(HEX_OPEN):
 case YY_STATE_EOF(ALLOW_SPECIAL_NUMBERS):
-#line 261 "json_scanner.yy"
+#line 281 "json_scanner.yy"
 return yy::json_parser::token::END;
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 262 "json_scanner.yy"
+#line 282 "json_scanner.yy"
 ECHO;
 	YY_BREAK
 #line 3667 "json_scanner.cc"
@@ -4523,4 +4543,4 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 262 "json_scanner.yy"
+#line 282 "json_scanner.yy"
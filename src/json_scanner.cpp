@@ -25,6 +25,7 @@
 #include "json_parser.hh"
 
 #include <ctype.h>
+#include <string.h>
 
 #include <QtCore/QDebug>
 #include <QtCore/QRegExp>
@@ -32,10 +33,51 @@
 #include <cassert>
 
 
+// Cancellation and timeout are checked once every this many tokens:
+// reading the clock on each of them would slow down scanning noticeably
+static const int ABORT_CHECK_INTERVAL = 256;
+
 JSonScanner::JSonScanner(QIODevice* io)
   : m_allowSpecialNumbers(false),
     m_io (io),
+    m_data(0),
+    m_dataSize(0),
+    m_cancelled(0),
+    m_timeout(0),
+    m_progressCallback(0),
+    m_progressUserData(0),
+    m_bytesRead(0),
+    m_tokenCount(0),
+    m_depth(0),
+    m_maxDepth(0),
+    m_maxDocumentSize(0),
+    m_maxStringLength(0),
+    m_criticalError(false),
+    m_currentStringLength(0),
+    m_validateOnly(false),
+    m_C_locale(QLocale::C)
+{
+
+}
+
+JSonScanner::JSonScanner(const char* data, qint64 size)
+  : m_allowSpecialNumbers(false),
+    m_io (0),
+    m_data(data),
+    m_dataSize(size),
+    m_cancelled(0),
+    m_timeout(0),
+    m_progressCallback(0),
+    m_progressUserData(0),
+    m_bytesRead(0),
+    m_tokenCount(0),
+    m_depth(0),
+    m_maxDepth(0),
+    m_maxDocumentSize(0),
+    m_maxStringLength(0),
     m_criticalError(false),
+    m_currentStringLength(0),
+    m_validateOnly(false),
     m_C_locale(QLocale::C)
 {
 
@@ -49,33 +91,212 @@ void JSonScanner::allowSpecialNumbers(bool allow) {
   m_allowSpecialNumbers = allow;
 }
 
+void JSonScanner::setCancellationFlag(const QAtomicInt* flag) {
+  m_cancelled = flag;
+}
+
+void JSonScanner::setTimeout(int msecs) {
+  m_timeout = msecs;
+  if (m_timeout > 0)
+    m_timer.start();
+}
+
+void JSonScanner::setProgressCallback(QJson::Parser::ProgressCallback callback, void* userData) {
+  m_progressCallback = callback;
+  m_progressUserData = userData;
+}
+
+void JSonScanner::setMaxDepth(int depth) {
+  m_maxDepth = depth;
+}
+
+void JSonScanner::setMaxDocumentSize(qint64 size) {
+  m_maxDocumentSize = size;
+}
+
+void JSonScanner::setMaxStringLength(int length) {
+  m_maxStringLength = length;
+}
+
+void JSonScanner::setReadBufferSize(int size) {
+  if (size > 0)
+    yy_switch_to_buffer(yy_create_buffer(yyin, size));
+}
+
+void JSonScanner::setValidateOnly(bool validateOnly) {
+  m_validateOnly = validateOnly;
+}
+
+QString JSonScanner::errorString() const {
+  return m_errorString;
+}
+
+void JSonScanner::setCriticalError(const char* message) {
+  m_errorString = QLatin1String(message);
+  m_criticalError = true;
+}
+
+bool JSonScanner::checkAbort() {
+  if (m_cancelled) {
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+    const bool cancelled = m_cancelled->load() != 0;
+#else
+    const bool cancelled = *m_cancelled != 0;
+#endif
+    if (cancelled) {
+      setCriticalError("Parsing cancelled");
+      return true;
+    }
+  }
+
+  if (m_timeout > 0 && m_timer.hasExpired(m_timeout)) {
+    setCriticalError("Parsing timed out");
+    return true;
+  }
+
+  return false;
+}
+
+bool JSonScanner::stringLengthExceeded() {
+  if (m_maxStringLength > 0 && m_currentStringLength > m_maxStringLength) {
+    setCriticalError("Maximum string length exceeded");
+    return true;
+  }
+  return false;
+}
+
+bool JSonScanner::appendString(const char* utf8, int length) {
+  if (!m_validateOnly) {
+    const int oldSize = m_currentString.size();
+    m_currentString.append(QString::fromUtf8(utf8, length));
+    m_currentStringLength += m_currentString.size() - oldSize;
+    return !stringLengthExceeded();
+  }
+
+  // count the UTF-16 code units the text would decode to: one for each
+  // sequence start byte, two for the ones outside the BMP
+  for (int i = 0; i < length; ++i) {
+    const uchar c = utf8[i];
+    if ((c & 0xC0) != 0x80)
+      ++m_currentStringLength;
+    if (c >= 0xF0)
+      ++m_currentStringLength;
+  }
+  return !stringLengthExceeded();
+}
+
+bool JSonScanner::appendChar(ushort unicode) {
+  if (!m_validateOnly)
+    m_currentString.append(QChar(unicode));
+  ++m_currentStringLength;
+  return !stringLengthExceeded();
+}
+
+// Flex buffers the whole text of a token before its action runs, so a
+// long run of plain characters in a string would be read entirely before
+// appendString() could check it. No UTF-8 sequence takes more than three
+// bytes per UTF-16 code unit, which bounds the text worth buffering.
+bool JSonScanner::pendingStringExceeded(const char* buf) {
+  if (m_maxStringLength <= 0 || (YY_START != QUOTMARK_OPEN && YY_START != HEX_OPEN) || !YY_CURRENT_BUFFER)
+    return false;
+  // the text of the current token was moved to the start of the buffer
+  // and the input goes right after it
+  const qint64 pending = buf - YY_CURRENT_BUFFER_LVALUE->yy_ch_buf;
+  if (pending > 3 * qint64(m_maxStringLength - m_currentStringLength)) {
+    setCriticalError("Maximum string length exceeded");
+    return true;
+  }
+  return false;
+}
+
+// Returns true for numbers which certainly neither overflow nor underflow
+// a double: the mantissa of a short one can't be far from 1 and its
+// exponent has no more than two digits.
+bool JSonScanner::isInDoubleRange(const char* number, int length) {
+  if (length > 200)
+    return false;
+  const char* exponent = strpbrk(number, "eE");
+  if (!exponent)
+    return true;
+  ++exponent;
+  if (*exponent == '+' || *exponent == '-')
+    ++exponent;
+  return strlen(exponent) <= 2;
+}
+
 int JSonScanner::yylex(YYSTYPE* yylval, yy::location *yylloc) {
   m_yylval = yylval;
   m_yylloc = yylloc;
   m_yylloc->step();
+
+  if (++m_tokenCount % ABORT_CHECK_INTERVAL == 0 && checkAbort()) {
+    return -1;
+  }
+
   int result = yylex();
   
   if (m_criticalError) {
     return -1;
   }
+
+  // track the nesting level here rather than in the grammar, so that
+  // documents which are too deep are rejected before the parser stack grows
+  if (result == yy::json_parser::token::SQUARE_BRACKET_OPEN ||
+      result == yy::json_parser::token::CURLY_BRACKET_OPEN) {
+    if (++m_depth > m_maxDepth && m_maxDepth > 0) {
+      setCriticalError("Maximum depth exceeded");
+      return -1;
+    }
+  } else if (result == yy::json_parser::token::SQUARE_BRACKET_CLOSE ||
+             result == yy::json_parser::token::CURLY_BRACKET_CLOSE) {
+    --m_depth;
+  }
   
   return result;
 }
 
 int JSonScanner::LexerInput(char* buf, int max_size) {
-  if (!m_io->isOpen()) {
-    qCritical() << "JSonScanner::yylex - io device is not open";
-    m_criticalError = true;
+  if (pendingStringExceeded(buf))
     return 0;
+
+  int readBytes;
+  if (!m_io) {
+    // reading from memory, m_bytesRead is the current position
+    readBytes = static_cast<int>(qMin<qint64>(max_size, m_dataSize - m_bytesRead));
+    memcpy(buf, m_data + m_bytesRead, readBytes);
+  } else {
+    if (!m_io->isOpen()) {
+      qCritical() << "JSonScanner::yylex - io device is not open";
+      m_criticalError = true;
+      return 0;
+    }
+
+    // read at most one byte past the size limit, enough to tell an
+    // oversized document from one which is exactly at the limit
+    qint64 toRead = max_size;
+    if (m_maxDocumentSize > 0)
+      toRead = qMin(toRead, m_maxDocumentSize + 1 - m_bytesRead);
+    readBytes = m_io->read(buf, toRead);
+    if(readBytes < 0) {
+      qCritical() << "JSonScanner::yylex - error while reading from io device";
+      m_criticalError = true;
+      return 0;
+    }
   }
-  
-  int readBytes = m_io->read(buf, max_size);
-  if(readBytes < 0) {
-    qCritical() << "JSonScanner::yylex - error while reading from io device";
-    m_criticalError = true;
-    return 0;
+
+  if (readBytes > 0) {
+    m_bytesRead += readBytes;
+    if (m_maxDocumentSize > 0 && m_bytesRead > m_maxDocumentSize) {
+      setCriticalError("Maximum document size exceeded");
+      return 0;
+    }
+    if (m_progressCallback)
+      m_progressCallback(m_bytesRead, m_progressUserData);
   }
-  
+
+  if (checkAbort())
+    return 0;
+
   return readBytes;
 }
 
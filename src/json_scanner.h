@@ -21,6 +21,8 @@
 #ifndef _JSON_SCANNER
 #define _JSON_SCANNER
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QIODevice>
 #include <QtCore/QVariant>
 #include <QtCore/QLocale>
@@ -45,21 +47,60 @@ class JSonScanner : public yyFlexLexer
 {
     public:
         explicit JSonScanner(QIODevice* io);
+        // scans size bytes of memory in place, data must outlive the scanner
+        JSonScanner(const char* data, qint64 size);
         ~JSonScanner();
 
         void allowSpecialNumbers(bool allow);
+        void setCancellationFlag(const QAtomicInt* flag);
+        void setTimeout(int msecs);
+        void setProgressCallback(QJson::Parser::ProgressCallback callback, void* userData);
+        void setMaxDepth(int depth);
+        void setMaxDocumentSize(qint64 size);
+        void setMaxStringLength(int length);
+        // must be called before scanning starts, 0 keeps the flex default
+        void setReadBufferSize(int size);
+        // check the input only: strings are measured but not decoded
+        void setValidateOnly(bool validateOnly);
+
+        QString errorString() const;
 
         int yylex(YYSTYPE* yylval, yy::location *yylloc);
         int yylex();
         int LexerInput(char* buf, int max_size);
     protected:
+        bool checkAbort();
+        bool stringLengthExceeded();
+        // return false once the string is longer than the limit
+        bool appendString(const char* utf8, int length);
+        bool appendChar(ushort unicode);
+        bool pendingStringExceeded(const char* buf);
+        static bool isInDoubleRange(const char* number, int length);
+        void setCriticalError(const char* message);
+
         bool m_allowSpecialNumbers;
         QIODevice* m_io;
+        const char* m_data;
+        qint64 m_dataSize;
+        const QAtomicInt* m_cancelled;
+        int m_timeout;
+        QElapsedTimer m_timer;
+        QJson::Parser::ProgressCallback m_progressCallback;
+        void* m_progressUserData;
+        qint64 m_bytesRead;
+        quint64 m_tokenCount;
+        int m_depth;
+        int m_maxDepth;
+        qint64 m_maxDocumentSize;
+        int m_maxStringLength;
+        QString m_errorString;
 
         YYSTYPE* m_yylval;
         yy::location* m_yylloc;
         bool m_criticalError;
         QString m_currentString;
+        int m_currentStringLength;
+        bool m_validateOnly;
         QLocale m_C_locale;
 };
 
@@ -34,6 +34,10 @@
   #define strtoull _strtoui64
   #endif
 
+  // fill the whole free part of the buffer on each read, its size is
+  // set by JSonScanner::setReadBufferSize()
+  #define YY_READ_BUF_SIZE (1 << 30)
+
   #define YY_USER_INIT if(m_allowSpecialNumbers) { \
     BEGIN(ALLOW_SPECIAL_NUMBERS); \
   }
@@ -53,7 +57,12 @@
               }
 
 [\r\n]+       { 
-                m_yylloc->lines(yyleng);
+                int lines = 0;
+                for (int i = 0; i < yyleng; ++i) {
+                  if (yytext[i] == '\n' || i + 1 == yyleng || yytext[i + 1] != '\n')
+                    ++lines;
+                }
+                m_yylloc->lines(lines);
               }
 
 
@@ -104,8 +113,11 @@ null          {
 
 -?(([0-9])|([1-9][0-9]+))(\.[0-9]+)?([Ee][+\-]?[0-9]+)? {
                 m_yylloc->columns(yyleng);
-                bool ok;
-                *m_yylval = QVariant(m_C_locale.toDouble(QLatin1String(yytext),&ok));
+                bool ok = true;
+                // when only validating, numbers which can't be out of range
+                // aren't converted at all
+                if (!m_validateOnly || !isInDoubleRange(yytext, yyleng))
+                  *m_yylval = QVariant(m_C_locale.toDouble(QLatin1String(yytext),&ok));
                 if (!ok) {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
                     // See QTBUG-71256
@@ -125,35 +137,43 @@ null          {
               
 <QUOTMARK_OPEN>{
   \\\"          {
-                  m_currentString.append(QLatin1String("\""));
+                  if (!appendChar('"'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\\\          {
-                  m_currentString.append(QLatin1String("\\"));
+                  if (!appendChar('\\'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\\/          {
-                  m_currentString.append(QLatin1String("/"));
+                  if (!appendChar('/'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\b           {
-                   m_currentString.append(QLatin1String("\b"));
+                   if (!appendChar('\b'))
+                     return yy::json_parser::token::INVALID;
                 }
                 
   \\f           {
-                  m_currentString.append(QLatin1String("\f"));
+                  if (!appendChar('\f'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\n           {
-                  m_currentString.append(QLatin1String("\n"));
+                  if (!appendChar('\n'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\r           {
-                  m_currentString.append(QLatin1String("\r"));
+                  if (!appendChar('\r'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\t           {
-                  m_currentString.append(QLatin1String("\t"));
+                  if (!appendChar('\t'))
+                    return yy::json_parser::token::INVALID;
                 }
                 
   \\u           {
@@ -161,7 +181,8 @@ null          {
                 }
                 
   [^\"\\]+      {
-                  m_currentString.append(QString::fromUtf8(yytext));
+                  if (!appendString(yytext, yyleng))
+                    return yy::json_parser::token::INVALID;
                 }
 
   \\            {
@@ -170,8 +191,10 @@ null          {
                 
   \"            {
                   m_yylloc->columns(yyleng);
-                  *m_yylval = QVariant(m_currentString);
+                  if (!m_validateOnly)
+                    *m_yylval = QVariant(m_currentString);
                   m_currentString.clear();
+                  m_currentStringLength = 0;
                   BEGIN(INITIAL);
                   return yy::json_parser::token::STRING;
                 }
@@ -186,11 +209,8 @@ null          {
 
 <HEX_OPEN>{
   [0-9A-Fa-f]{4} {
-                    QString hexDigits = QString::fromUtf8(yytext, yyleng);
-                    bool ok;
-                    ushort hexDigit1 = hexDigits.left(2).toShort(&ok, 16);
-                    ushort hexDigit2 = hexDigits.right(2).toShort(&ok, 16);    
-                    m_currentString.append(QChar(hexDigit2, hexDigit1));
+                    if (!appendChar(static_cast<ushort>(strtoul(yytext, NULL, 16))))
+                      return yy::json_parser::token::INVALID;
                     BEGIN(QUOTMARK_OPEN);
                  }
                  
@@ -24,7 +24,7 @@
 #include "json_parser.hh"
 #include "json_scanner.h"
 
-#include <QtCore/QBuffer>
+#include <QtCore/QFile>
 #include <QtCore/QStringList>
 #include <QtCore/QTextStream>
 #include <QtCore/QDebug>
@@ -33,7 +33,19 @@ using namespace QJson;
 
 ParserPrivate::ParserPrivate() :
   m_scanner(0),
-  m_specialNumbersAllowed(false)
+  m_validateOnly(false),
+  m_specialNumbersAllowed(false),
+  m_timeout(0),
+  m_progressCallback(0),
+  m_progressUserData(0),
+  m_maxDepth(0),
+  m_maxDocumentSize(0),
+  m_readBufferSize(0),
+  m_maxStringLength(0),
+  m_maxElementCount(0),
+  m_objectType(Parser::MapObjects),
+  m_duplicateKeyPolicy(Parser::LastKeyWins),
+  m_keyInternTableSize(0)
 {
   reset();
 }
@@ -47,18 +59,51 @@ ParserPrivate::~ParserPrivate()
 QVariant ParserPrivate::parse(QIODevice* io, bool* ok)
 {
   m_scanner = new JSonScanner (io);
+  run(ok);
+  io->close();
+  return m_result;
+}
+
+QVariant ParserPrivate::parse(const char* data, qint64 size, bool* ok)
+{
+  m_scanner = new JSonScanner (data, size);
+  run(ok);
+  return m_result;
+}
+
+void ParserPrivate::run(bool* ok)
+{
   m_scanner->allowSpecialNumbers(m_specialNumbersAllowed);
+  m_scanner->setCancellationFlag(&m_cancelled);
+  m_scanner->setTimeout(m_timeout);
+  m_scanner->setProgressCallback(m_progressCallback, m_progressUserData);
+  m_scanner->setMaxDepth(m_maxDepth);
+  m_scanner->setMaxDocumentSize(m_maxDocumentSize);
+  m_scanner->setMaxStringLength(m_maxStringLength);
+  m_scanner->setReadBufferSize(m_readBufferSize);
+  m_scanner->setValidateOnly(m_validateOnly);
   yy::json_parser parser(this);
   parser.parse();
 
+  // the scanner knows better than the grammar why the input was rejected
+  if (!m_scanner->errorString().isEmpty())
+    setError(m_scanner->errorString(), m_errorLine);
+
   delete m_scanner;
   m_scanner = 0;
 
+  // a cancellation request, made before or during this operation, has
+  // been served by now and must not abort the next one
+  m_cancelled.fetchAndStoreOrdered(0);
+
+  // release whatever was left over by an aborted parse
+  m_arrays.clear();
+  m_objects.clear();
+  m_hashes.clear();
+  m_elementCounts.clear();
+
   if (ok != 0)
     *ok = !m_error;
-
-  io->close();
-  return m_result;
 }
 
 void ParserPrivate::setError(const QString &errorMsg, int errorLine) {
@@ -67,11 +112,126 @@ void ParserPrivate::setError(const QString &errorMsg, int errorLine) {
   m_errorLine = errorLine;
 }
 
+void ParserPrivate::beginArray()
+{
+  if (m_validateOnly)
+    m_elementCounts.push(0);
+  else
+    m_arrays.push(QVariantList());
+}
+
+bool ParserPrivate::appendElement(const QVariant& value, int line)
+{
+  if (m_validateOnly)
+    return countElement(line);
+
+  QVariantList& list = m_arrays.top();
+  if (m_maxElementCount > 0 && list.size() >= m_maxElementCount) {
+    setError(QLatin1String("Maximum element count exceeded"), line);
+    return false;
+  }
+  list.append(value);
+  return true;
+}
+
+bool ParserPrivate::countElement(int line)
+{
+  int& count = m_elementCounts.top();
+  if (m_maxElementCount > 0 && count >= m_maxElementCount) {
+    setError(QLatin1String("Maximum element count exceeded"), line);
+    return false;
+  }
+  ++count;
+  return true;
+}
+
+QVariant ParserPrivate::endArray()
+{
+  if (m_validateOnly) {
+    m_elementCounts.pop();
+    return QVariant();
+  }
+  return QVariant(m_arrays.pop());
+}
+
+void ParserPrivate::beginObject()
+{
+  if (m_validateOnly)
+    m_elementCounts.push(0);
+  else if (m_objectType == Parser::HashObjects)
+    m_hashes.push(QVariantHash());
+  else
+    m_objects.push(QVariantMap());
+}
+
+// Inserts value under key with a single lookup, returns false if the key
+// was already there. The existing value is replaced only if overwrite is set.
+template <class Object>
+static bool insertOnce(Object& object, const QString& key, const QVariant& value, bool overwrite)
+{
+  const int size = object.size();
+  QVariant& slot = object[key];
+  const bool inserted = object.size() != size;
+  if (inserted || overwrite)
+    slot = value;
+  return inserted;
+}
+
+bool ParserPrivate::insertMember(const QVariant& key, const QVariant& value, int line)
+{
+  if (m_validateOnly)
+    return countElement(line);
+
+  const bool isHash = m_objectType == Parser::HashObjects;
+  const int size = isHash ? m_hashes.top().size() : m_objects.top().size();
+  if (m_maxElementCount > 0 && size >= m_maxElementCount) {
+    setError(QLatin1String("Maximum element count exceeded"), line);
+    return false;
+  }
+
+  const QString name = internKey(key.toString());
+  const bool overwrite = m_duplicateKeyPolicy == Parser::LastKeyWins;
+  const bool inserted = isHash ? insertOnce(m_hashes.top(), name, value, overwrite)
+                               : insertOnce(m_objects.top(), name, value, overwrite);
+  if (!inserted && m_duplicateKeyPolicy == Parser::DuplicateKeyError) {
+    setError(QString(QLatin1String("Duplicate key \"%1\"")).arg(name), line);
+    return false;
+  }
+  return true;
+}
+
+QVariant ParserPrivate::endObject()
+{
+  if (m_validateOnly) {
+    m_elementCounts.pop();
+    return QVariant();
+  }
+  if (m_objectType == Parser::HashObjects)
+    return QVariant(m_hashes.pop());
+  return QVariant(m_objects.pop());
+}
+
+QString ParserPrivate::internKey(const QString& key)
+{
+  if (m_keyInternTableSize <= 0)
+    return key;
+
+  QSet<QString>::const_iterator it = m_internedKeys.constFind(key);
+  if (it != m_internedKeys.constEnd())
+    return *it;
+
+  // once the table is full, new keys are simply not shared
+  if (m_internedKeys.size() < m_keyInternTableSize)
+    m_internedKeys.insert(key);
+  return key;
+}
+
 void ParserPrivate::reset()
 {
   m_error = false;
   m_errorLine = 0;
   m_errorMsg.clear();
+  m_result.clear();
   if (m_scanner) {
     delete m_scanner;
     m_scanner = 0;
@@ -117,19 +277,84 @@ QVariant Parser::parse(QIODevice* io, bool* ok)
     return QVariant();
   }
 
-  QByteArray buffer = io->readAll();
-  return parse(buffer, ok);
+  // the scanner pulls the data from the device as it goes, one buffer
+  // at a time, and enforces the maximum document size while reading
+  return d->parse(io, ok);
 }
 
 QVariant Parser::parse(const QByteArray& jsonString, bool* ok)
 {
   d->reset();
 
-  QBuffer buffer;
-  buffer.open(QBuffer::ReadWrite | QBuffer::Text);
-  buffer.write(jsonString);
-  buffer.seek(0);
-  return d->parse(&buffer, ok);
+  if (d->m_maxDocumentSize > 0 && jsonString.size() > d->m_maxDocumentSize) {
+    if (ok != 0)
+      *ok = false;
+    d->setError(QLatin1String("Maximum document size exceeded"), 0);
+    return QVariant();
+  }
+
+  // scan the data in place rather than copying it into a buffer
+  return d->parse(jsonString.constData(), jsonString.size(), ok);
+}
+
+QVariant Parser::parseFile(const QString& fileName, bool* ok)
+{
+  d->reset();
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    if (ok != 0)
+      *ok = false;
+    d->setError(QString(QLatin1String("Error opening file %1: %2")).arg(fileName).arg(file.errorString()), 0);
+    return QVariant();
+  }
+
+  // pipes, FIFOs and devices report no size, they can only be read
+  if (file.isSequential())
+    return parse(&file, ok);
+
+  const qint64 size = file.size();
+  if (size == 0) {
+    if (ok != 0)
+      *ok = false;
+    d->setError(QLatin1String("No data"), 0);
+    return QVariant();
+  }
+
+  if (d->m_maxDocumentSize > 0 && size > d->m_maxDocumentSize) {
+    if (ok != 0)
+      *ok = false;
+    d->setError(QLatin1String("Maximum document size exceeded"), 0);
+    return QVariant();
+  }
+
+  uchar* data = file.map(0, size);
+  if (!data) {
+    // the platform refused to map it
+    return parse(&file, ok);
+  }
+
+  d->parse(reinterpret_cast<const char*>(data), size, ok);
+  file.unmap(data);
+  return d->m_result;
+}
+
+bool Parser::validate(QIODevice* io)
+{
+  bool ok;
+  d->m_validateOnly = true;
+  parse(io, &ok);
+  d->m_validateOnly = false;
+  return ok;
+}
+
+bool Parser::validate(const QByteArray& jsonData)
+{
+  bool ok;
+  d->m_validateOnly = true;
+  parse(jsonData, &ok);
+  d->m_validateOnly = false;
+  return ok;
 }
 
 QString Parser::errorString() const
@@ -149,3 +374,90 @@ void QJson::Parser::allowSpecialNumbers(bool allowSpecialNumbers) {
 bool Parser::specialNumbersAllowed() const {
   return d->m_specialNumbersAllowed;
 }
+
+void Parser::cancel() {
+  d->m_cancelled.fetchAndStoreOrdered(1);
+}
+
+void Parser::setTimeout(int msecs) {
+  d->m_timeout = msecs;
+}
+
+int Parser::timeout() const {
+  return d->m_timeout;
+}
+
+void Parser::setProgressCallback(ProgressCallback callback, void* userData) {
+  d->m_progressCallback = callback;
+  d->m_progressUserData = userData;
+}
+
+void Parser::setMaxDepth(int depth) {
+  d->m_maxDepth = depth;
+}
+
+int Parser::maxDepth() const {
+  return d->m_maxDepth;
+}
+
+void Parser::setMaxDocumentSize(qint64 size) {
+  d->m_maxDocumentSize = size;
+}
+
+qint64 Parser::maxDocumentSize() const {
+  return d->m_maxDocumentSize;
+}
+
+void Parser::setReadBufferSize(int size) {
+  d->m_readBufferSize = size;
+}
+
+int Parser::readBufferSize() const {
+  return d->m_readBufferSize;
+}
+
+void Parser::setMaxStringLength(int length) {
+  d->m_maxStringLength = length;
+}
+
+int Parser::maxStringLength() const {
+  return d->m_maxStringLength;
+}
+
+void Parser::setMaxElementCount(int count) {
+  d->m_maxElementCount = count;
+}
+
+int Parser::maxElementCount() const {
+  return d->m_maxElementCount;
+}
+
+void Parser::setObjectType(ObjectType type) {
+  d->m_objectType = type;
+}
+
+Parser::ObjectType Parser::objectType() const {
+  return d->m_objectType;
+}
+
+void Parser::setDuplicateKeyPolicy(DuplicateKeyPolicy policy) {
+  d->m_duplicateKeyPolicy = policy;
+}
+
+Parser::DuplicateKeyPolicy Parser::duplicateKeyPolicy() const {
+  return d->m_duplicateKeyPolicy;
+}
+
+void Parser::setKeyInternTableSize(int maxKeys) {
+  d->m_keyInternTableSize = maxKeys;
+  if (d->m_internedKeys.size() > qMax(maxKeys, 0))
+    d->m_internedKeys.clear();
+}
+
+int Parser::keyInternTableSize() const {
+  return d->m_keyInternTableSize;
+}
+
+void Parser::clearKeyInternTable() {
+  d->m_internedKeys.clear();
+}
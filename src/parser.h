@@ -25,6 +25,7 @@
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
+class QString;
 class QVariant;
 QT_END_NAMESPACE
 
@@ -41,6 +42,33 @@ namespace QJson {
   class QJSON_EXPORT Parser
   {
     public:
+      /**
+       * Callback used to report the progress of a parse operation
+       * @param bytesRead number of bytes consumed from the input so far
+       * @param userData the pointer given to setProgressCallback
+       * @sa setProgressCallback
+       */
+      typedef void (*ProgressCallback)(qint64 bytesRead, void* userData);
+
+      /**
+       * Container used for the JSON objects of the parsed document
+       * @sa setObjectType
+       */
+      enum ObjectType {
+        MapObjects,  /**< QVariantMap, members ordered by key (the default) */
+        HashObjects  /**< QVariantHash, cheaper to build and to look up for objects with many members */
+      };
+
+      /**
+       * What to do when an object contains the same key more than once
+       * @sa setDuplicateKeyPolicy
+       */
+      enum DuplicateKeyPolicy {
+        LastKeyWins,      /**< the last value is kept (the default) */
+        FirstKeyWins,     /**< the first value is kept */
+        DuplicateKeyError /**< the document is rejected */
+      };
+
       Parser();
       ~Parser();
 
@@ -62,6 +90,39 @@ namespace QJson {
       */
       QVariant parse(const QByteArray& jsonData, bool* ok = 0);
 
+      /**
+      * Parses the JSON document stored in a file. The file is memory mapped
+      * and scanned in place, so it is never read into a buffer as a whole.
+      * Files which can't be mapped, such as pipes and FIFOs, are read as
+      * parse(QIODevice*) does.
+      * @param fileName path of the file to parse
+      * @param ok if a conversion error occurs, *ok is set to false; otherwise *ok is set to true.
+      * @returns a QVariant object generated from the JSON string
+      * @sa errorString
+      * @sa errorLine
+      */
+      QVariant parseFile(const QString& fileName, bool* ok = 0);
+
+      /**
+      * Checks that the data read from \a io is a well formed JSON document
+      * without building its in-memory representation, which makes it much
+      * cheaper than parse(). The configured limits are enforced, but
+      * duplicate keys are not detected since keys are not decoded.
+      * @param io Input output device
+      * @returns true if the document is valid
+      * @sa errorString
+      * @sa errorLine
+      */
+      bool validate(QIODevice* io);
+
+      /**
+      * This is a method provided for convenience.
+      * @param jsonData data containing the JSON object representation
+      * @returns true if the document is valid
+      * @sa validate(QIODevice*)
+      */
+      bool validate(const QByteArray& jsonData);
+
       /**
       * This method returns the error message
       * @returns a QString object containing the error message of the last parse operation
@@ -90,6 +151,165 @@ namespace QJson {
        */
       bool specialNumbersAllowed() const;
 
+      /**
+       * Aborts the parse operation currently in progress.
+       * This method is thread-safe: it's meant to be called from another thread
+       * while parse() is running. The parser checks the request periodically,
+       * parse() then returns shortly after with *ok set to false and
+       * errorString() reporting the cancellation.
+       * A request made while no parse operation is running cancels the next
+       * one as soon as it starts reading its input. A request is discarded
+       * when the parse operation that read the input returns, whether that
+       * operation was cancelled or not.
+       */
+      void cancel();
+
+      /**
+       * Sets the maximum time a single parse operation may take. Once the
+       * timeout expires the operation is aborted, as if cancel() had been called.
+       * @param msecs timeout in milliseconds, 0 (the default) means no timeout
+       * @sa timeout
+       */
+      void setTimeout(int msecs);
+
+      /**
+       * @returns the timeout of a parse operation in milliseconds, 0 if there's none
+       * @sa setTimeout
+       */
+      int timeout() const;
+
+      /**
+       * Sets the function called every time a new chunk of input has been read.
+       * The callback is invoked from the thread running parse().
+       * @param callback the function to call, 0 disables progress reporting
+       * @param userData pointer passed back to the callback
+       */
+      void setProgressCallback(ProgressCallback callback, void* userData = 0);
+
+      /**
+       * Sets the maximum nesting level of arrays and objects. Deeper documents
+       * are rejected as soon as the limit is crossed.
+       * @param depth maximum nesting level, 0 (the default) means no limit
+       * @sa maxDepth
+       */
+      void setMaxDepth(int depth);
+
+      /**
+       * @returns the maximum nesting level of arrays and objects, 0 if there's no limit
+       * @sa setMaxDepth
+       */
+      int maxDepth() const;
+
+      /**
+       * Sets the maximum size of the JSON document. When parsing from an I/O
+       * device no more than this amount of data is read.
+       * @param size maximum size in bytes, 0 (the default) means no limit
+       * @sa maxDocumentSize
+       */
+      void setMaxDocumentSize(qint64 size);
+
+      /**
+       * @returns the maximum size of the JSON document in bytes, 0 if there's no limit
+       * @sa setMaxDocumentSize
+       */
+      qint64 maxDocumentSize() const;
+
+      /**
+       * Sets the size of the buffer the scanner reads its input into.
+       * Documents are read from I/O devices one buffer at a time, so the
+       * memory used for input doesn't grow with the size of the document;
+       * the buffer is only enlarged to hold a single token that doesn't fit.
+       * @param size buffer size in bytes, 0 (the default) means 16 KiB
+       * @sa readBufferSize
+       */
+      void setReadBufferSize(int size);
+
+      /**
+       * @returns the size of the scanner input buffer in bytes, 0 for the default
+       * @sa setReadBufferSize
+       */
+      int readBufferSize() const;
+
+      /**
+       * Sets the maximum length of a string value or of an object key.
+       * @param length maximum number of characters, 0 (the default) means no limit
+       * @sa maxStringLength
+       */
+      void setMaxStringLength(int length);
+
+      /**
+       * @returns the maximum length of a string, 0 if there's no limit
+       * @sa setMaxStringLength
+       */
+      int maxStringLength() const;
+
+      /**
+       * Sets the maximum number of elements of a single array, or of members
+       * of a single object.
+       * @param count maximum number of elements, 0 (the default) means no limit
+       * @sa maxElementCount
+       */
+      void setMaxElementCount(int count);
+
+      /**
+       * @returns the maximum number of elements of an array or an object, 0 if there's no limit
+       * @sa setMaxElementCount
+       */
+      int maxElementCount() const;
+
+      /**
+       * Sets the container used for the JSON objects of the documents
+       * parsed from now on.
+       * @param type MapObjects (the default) or HashObjects
+       * @sa objectType
+       */
+      void setObjectType(ObjectType type);
+
+      /**
+       * @returns the container used for JSON objects
+       * @sa setObjectType
+       */
+      ObjectType objectType() const;
+
+      /**
+       * Sets how keys appearing more than once in the same object are
+       * handled. Duplicates are detected while the object is built, at no
+       * extra cost.
+       * @param policy LastKeyWins (the default), FirstKeyWins or DuplicateKeyError
+       * @sa duplicateKeyPolicy
+       */
+      void setDuplicateKeyPolicy(DuplicateKeyPolicy policy);
+
+      /**
+       * @returns how keys appearing more than once in the same object are handled
+       * @sa setDuplicateKeyPolicy
+       */
+      DuplicateKeyPolicy duplicateKeyPolicy() const;
+
+      /**
+       * Enables sharing of object keys between the parsed objects. Keys
+       * found in the intern table reuse its implicitly shared string data
+       * instead of keeping a copy of their own, which saves memory when
+       * the same keys appear many times. The table is kept across parse
+       * calls and grows up to the given number of keys.
+       * @param maxKeys size of the table, 0 (the default) disables interning
+       * @sa keyInternTableSize
+       * @sa clearKeyInternTable
+       */
+      void setKeyInternTableSize(int maxKeys);
+
+      /**
+       * @returns the maximum number of keys of the intern table, 0 if interning is disabled
+       * @sa setKeyInternTableSize
+       */
+      int keyInternTableSize() const;
+
+      /**
+       * Removes all the keys from the intern table
+       * @sa setKeyInternTableSize
+       */
+      void clearKeyInternTable();
+
     private:
       Q_DISABLE_COPY(Parser)
       ParserPrivate* const d;
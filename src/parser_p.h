@@ -24,6 +24,9 @@
 
 #include "parser.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSet>
+#include <QtCore/QStack>
 #include <QtCore/QString>
 #include <QtCore/QVariant>
 
@@ -42,17 +45,51 @@ namespace QJson {
       ~ParserPrivate();
 
       QVariant parse(QIODevice* io, bool* ok);
+      QVariant parse(const char* data, qint64 size, bool* ok);
+      void run(bool* ok);
 
       void reset();
 
       void setError(const QString &errorMsg, int line);
 
+      // Containers are built bottom-up by the grammar: the innermost
+      // array or object being filled is always on top of its stack
+      void beginArray();
+      bool appendElement(const QVariant& value, int line);
+      bool countElement(int line);
+      QVariant endArray();
+
+      void beginObject();
+      bool insertMember(const QVariant& key, const QVariant& value, int line);
+      QVariant endObject();
+
+      QString internKey(const QString& key);
+
       JSonScanner* m_scanner;
       bool m_error;
       int m_errorLine;
       QString m_errorMsg;
       QVariant m_result;
+      bool m_validateOnly;
       bool m_specialNumbersAllowed;
+      QAtomicInt m_cancelled;
+      int m_timeout;
+      Parser::ProgressCallback m_progressCallback;
+      void* m_progressUserData;
+      int m_maxDepth;
+      qint64 m_maxDocumentSize;
+      int m_readBufferSize;
+      int m_maxStringLength;
+      int m_maxElementCount;
+      Parser::ObjectType m_objectType;
+      Parser::DuplicateKeyPolicy m_duplicateKeyPolicy;
+      int m_keyInternTableSize;
+      QSet<QString> m_internedKeys;
+      QStack<QVariantList> m_arrays;
+      QStack<QVariantMap> m_objects;
+      QStack<QVariantHash> m_hashes;
+      // number of elements of each open container, used when only validating
+      QStack<int> m_elementCounts;
   };
 }
 
@@ -22,13 +22,493 @@
 
 
 #include "qobjecthelper.h"
+#include "qobjecthelper_p.h"
+#include "streamreader.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QMetaObject>
 #include <QtCore/QMetaProperty>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QStack>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QVector>
 
 using namespace QJson;
 
+namespace {
+
+  // The tables of the meta-objects seen so far, the conversions may be
+  // run from several threads at once
+  struct PropertyTableCache {
+    PropertyTableCache() : enabled( true ) {}
+    QMutex mutex;
+    bool enabled;
+    QHash<const QMetaObject*, QSharedPointer<const PropertyTable> > tables;
+  };
+
+  PropertyTable* buildPropertyTable( const QMetaObject* metaobject )
+  {
+    PropertyTable* table = new PropertyTable;
+    QHash<QString, int> readableByName;
+    const int count = metaobject->propertyCount();
+    for ( int i = 0; i < count; ++i ) {
+      PropertyEntry entry;
+      entry.property = metaobject->property( i );
+      entry.name = QLatin1String( entry.property.name() );
+      entry.type = entry.property.type();
+      entry.isVariant = QLatin1String("QVariant") == QLatin1String( entry.property.typeName() );
+
+      // a property redeclared by a subclass is read from the subclass
+      // only, so that each name is written once
+      if ( entry.property.isReadable() ) {
+        QHash<QString, int>::const_iterator redeclared = readableByName.constFind( entry.name );
+        if ( redeclared != readableByName.constEnd() ) {
+          table->readable[redeclared.value()] = entry;
+        } else {
+          readableByName.insert( entry.name, table->readable.size() );
+          table->readable.append( entry );
+        }
+      }
+      // like indexOfProperty(), the last declaration of a name wins
+      table->byName.insert( entry.name, table->properties.size() );
+      table->properties.append( entry );
+    }
+    table->cached = false;
+    return table;
+  }
+
+}
+
+Q_GLOBAL_STATIC(PropertyTableCache, propertyTableCache)
+
+QSharedPointer<const PropertyTable> QJson::propertyTable( const QMetaObject* metaobject )
+{
+  PropertyTableCache* cache = propertyTableCache();
+  QMutexLocker locker( &cache->mutex );
+  if ( !cache->enabled ) {
+    locker.unlock();
+    return QSharedPointer<const PropertyTable>( buildPropertyTable( metaobject ) );
+  }
+
+  QSharedPointer<const PropertyTable>& table = cache->tables[metaobject];
+  if ( !table ) {
+    PropertyTable* newTable = buildPropertyTable( metaobject );
+    newTable->cached = true;
+    table = QSharedPointer<const PropertyTable>( newTable );
+  }
+  return table;
+}
+
+namespace {
+
+  // The properties are accessed through one of these, so that the same
+  // conversions serve QObjects and gadgets
+  struct ObjectAccess {
+    explicit ObjectAccess( QObject* object ) : object( object ) {}
+    QVariant read( const QMetaProperty& property ) const { return property.read( object ); }
+    void write( const QMetaProperty& property, const QVariant& value ) const { property.write( object, value ); }
+    QObject* object;
+  };
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+  struct GadgetAccess {
+    explicit GadgetAccess( void* gadget ) : gadget( gadget ) {}
+    QVariant read( const QMetaProperty& property ) const { return property.readOnGadget( gadget ); }
+    void write( const QMetaProperty& property, const QVariant& value ) const { property.writeOnGadget( gadget, value ); }
+    void* gadget;
+  };
+#endif
+
+  // Converts value to the type of the property, returns false if it can't
+  // be assigned to it
+  bool convertForProperty( const PropertyEntry& entry, QVariant& value )
+  {
+    if ( value.canConvert( entry.type ) ) {
+      value.convert( entry.type );
+      return true;
+    }
+    return entry.isVariant;
+  }
+
+  // Assigns value to the property, if it can be converted to its type
+  template <class Access>
+  void writeProperty( const PropertyEntry& entry, const Access& access, QVariant& value )
+  {
+    if ( convertForProperty( entry, value ) )
+      access.write( entry.property, value );
+  }
+
+  // Marks the readable properties of table which are in ignoredProperties.
+  // The few ignored names are looked up once, rather than every property
+  // in them.
+  void ignoredMask( const PropertyTable* table, const QStringList& ignoredProperties,
+                    QVarLengthArray<bool, 64>& ignored )
+  {
+    const QVector<PropertyEntry>& readable = table->readable;
+    ignored.resize( readable.size() );
+    for ( int i = 0; i < readable.size(); ++i )
+      ignored[i] = false;
+    for ( QStringList::const_iterator it = ignoredProperties.constBegin(),
+          end = ignoredProperties.constEnd(); it != end; ++it ) {
+      for ( int i = 0; i < readable.size(); ++i ) {
+        if ( readable.at( i ).name == *it )
+          ignored[i] = true;
+      }
+    }
+  }
+
+  template <class Access>
+  QVariantMap readProperties( const PropertyTable* table, const Access& access,
+                              const QStringList& ignoredProperties )
+  {
+    QVariantMap result;
+    const QVector<PropertyEntry>& readable = table->readable;
+    QVarLengthArray<bool, 64> ignored;
+    ignoredMask( table, ignoredProperties, ignored );
+
+    for ( int i = 0; i < readable.size(); ++i ) {
+      if ( ignored[i] )
+        continue;
+      const PropertyEntry& entry = readable.at( i );
+      result.insert( entry.name, access.read( entry.property ) );
+    }
+    return result;
+  }
+
+  template <class Access>
+  void writeProperties( const QVariantMap& variant, const PropertyTable* table, const Access& access )
+  {
+    for (QVariantMap::const_iterator iter = variant.constBegin(),
+         end = variant.constEnd(); iter != end; ++iter) {
+      QHash<QString, int>::const_iterator found = table->byName.constFind( iter.key() );
+
+      if ( found == table->byName.constEnd() ) {
+        continue;
+      }
+
+      QVariant v( iter.value() );
+      writeProperty( table->properties.at( found.value() ), access, v );
+    }
+  }
+
+  // Reads the value starting at the current token of the reader, arrays
+  // and objects included. Containers are kept on explicit stacks, so deep
+  // documents can't overflow the call stack.
+  bool readVariant( StreamReader& reader, QVariant& result )
+  {
+    // one entry for each open container, true for objects
+    QStack<bool> inObject;
+    QStack<QVariantList> arrays;
+    QStack<QVariantMap> objects;
+    // the key each open container is going to be inserted with
+    QStack<QString> names;
+
+    StreamReader::TokenType type = reader.tokenType();
+    for (;;) {
+      if ( type == StreamReader::StartArray || type == StreamReader::StartObject ) {
+        inObject.push( type == StreamReader::StartObject );
+        if ( type == StreamReader::StartObject )
+          objects.push( QVariantMap() );
+        else
+          arrays.push( QVariantList() );
+        names.push( reader.name() );
+      } else {
+        QVariant value;
+        QString name;
+        if ( type == StreamReader::EndArray || type == StreamReader::EndObject ) {
+          value = inObject.pop() ? QVariant( objects.pop() ) : QVariant( arrays.pop() );
+          name = names.pop();
+        } else {
+          value = reader.value();
+          name = reader.name();
+        }
+
+        if ( inObject.isEmpty() ) {
+          result = value;
+          return true;
+        }
+        if ( inObject.top() )
+          objects.top().insert( name, value );
+        else
+          arrays.top().append( value );
+      }
+
+      type = reader.readNext();
+      if ( reader.hasError() )
+        return false;
+    }
+  }
+
+  // Reads the members of the object whose start is the current token of
+  // the reader into the properties of object
+  bool readObject( StreamReader& reader, QObject* object )
+  {
+    const QSharedPointer<const PropertyTable> table = propertyTable( object->metaObject() );
+
+    for (;;) {
+      const StreamReader::TokenType type = reader.readNext();
+      if ( type == StreamReader::EndObject )
+        return true;
+      if ( reader.hasError() )
+        return false;
+
+      QHash<QString, int>::const_iterator found = table->byName.constFind( reader.name() );
+      if ( found == table->byName.constEnd() ) {
+        reader.skipCurrentElement();
+        continue;
+      }
+
+      const PropertyEntry& entry = table->properties.at( found.value() );
+      if ( type == StreamReader::StartObject && isQObjectPointer( entry.property.userType() ) ) {
+        QObject* child = entry.property.read( object ).value<QObject*>();
+        if ( child ) {
+          if ( !readObject( reader, child ) )
+            return false;
+          continue;
+        }
+      }
+
+      if ( !entry.property.isWritable() ) {
+        reader.skipCurrentElement();
+        continue;
+      }
+
+      QVariant value;
+      if ( !readVariant( reader, value ) )
+        return false;
+      writeProperty( entry, ObjectAccess( object ), value );
+    }
+  }
+
+  // Reads a whole document, either an object into object or, if it's null,
+  // an array of objects into the objects created by factory
+  bool readDocument( StreamReader& reader, QObject* object, ObjectFactory* factory, QString* errorString )
+  {
+    reader.readNext();
+    const StreamReader::TokenType type = reader.readNext();
+
+    bool ok;
+    if ( object ) {
+      ok = type == StreamReader::StartObject && readObject( reader, object );
+    } else {
+      ok = type == StreamReader::StartArray;
+      while ( ok && reader.readNext() != StreamReader::EndArray ) {
+        if ( reader.tokenType() != StreamReader::StartObject ) {
+          ok = false;
+          break;
+        }
+        QObject* element = factory->create();
+        ok = element && readObject( reader, element );
+      }
+    }
+    ok = ok && reader.readNext() == StreamReader::EndDocument;
+
+    if ( !ok && errorString ) {
+      *errorString = reader.hasError() ? reader.errorString()
+                                       : QString( QLatin1String( "The document doesn't match the objects" ) );
+    }
+    return ok;
+  }
+
+  // Below this many objects per thread, a bulk conversion isn't split
+  const int minimumChunkSize = 64;
+
+  // A property value read from, or to be written to, an object of a bulk
+  // conversion
+  struct PropertyValue {
+    int object;
+    const PropertyEntry* entry;
+    QVariant value;
+  };
+
+  // Converts a range of the objects of a bulk conversion. The objects
+  // are only accessed by the calling thread, in prepare() and write():
+  // their getters and setters, and the slots connected to their NOTIFY
+  // signals, may well not be safe to call from anywhere else. Only
+  // convert() is run by the threads of the pool. Chunks share nothing
+  // they modify.
+  class ConversionChunk : public QRunnable {
+    public:
+      ConversionChunk() :
+        begin(0), end(0), objects(0), variants(0), results(0),
+        ignoredProperties(0), done(0) {
+        setAutoDelete( false );
+      }
+
+      void run() {
+        convert();
+        done->release();
+      }
+
+      // Looks up the tables of the objects and, when converting from them,
+      // reads their properties. Run by the calling thread.
+      void prepare() {
+        // the objects of a list are usually all of the same class, so the
+        // shared cache is seldom locked
+        const QMetaObject* lastMetaObject = 0;
+        QVarLengthArray<bool, 64> ignored;
+        objectTables.fill( 0, end - begin );
+        for ( int i = begin; i < end; ++i ) {
+          QObject* object = objects->at( i );
+          if ( !object )
+            continue;
+          if ( object->metaObject() != lastMetaObject ) {
+            lastMetaObject = object->metaObject();
+            tables.append( propertyTable( lastMetaObject ) );
+            if ( results )
+              ignoredMask( tables.last().data(), *ignoredProperties, ignored );
+          }
+          objectTables[i - begin] = tables.last().data();
+          if ( !results )
+            continue;
+
+          const QVector<PropertyEntry>& readable = tables.last()->readable;
+          for ( int j = 0; j < readable.size(); ++j ) {
+            if ( ignored[j] )
+              continue;
+            const PropertyValue value = { i, &readable.at( j ), readable.at( j ).property.read( object ) };
+            values.append( value );
+          }
+        }
+      }
+
+      // Builds the QVariantMaps from the values read, or converts the
+      // QVariantMaps to the values to write. Run by any thread.
+      void convert() {
+        if ( results ) {
+          for ( int i = begin; i < end; ++i ) {
+            if ( objectTables.at( i - begin ) )
+              results[i] = QVariantMap();
+          }
+          QVariantMap map;
+          int object = -1;
+          for ( QVector<PropertyValue>::const_iterator it = values.constBegin(),
+                last = values.constEnd(); it != last; ++it ) {
+            if ( it->object != object ) {
+              if ( object >= 0 )
+                results[object] = map;
+              map = QVariantMap();
+              object = it->object;
+            }
+            map.insert( it->entry->name, it->value );
+          }
+          if ( object >= 0 )
+            results[object] = map;
+          return;
+        }
+
+        for ( int i = begin; i < end; ++i ) {
+          const PropertyTable* table = objectTables.at( i - begin );
+          if ( !table )
+            continue;
+          const QVariantMap variant = variants->at( i ).toMap();
+          for ( QVariantMap::const_iterator iter = variant.constBegin(),
+                last = variant.constEnd(); iter != last; ++iter ) {
+            QHash<QString, int>::const_iterator found = table->byName.constFind( iter.key() );
+            if ( found == table->byName.constEnd() )
+              continue;
+            PropertyValue value = { i, &table->properties.at( found.value() ), iter.value() };
+            if ( convertForProperty( *value.entry, value.value ) )
+              values.append( value );
+          }
+        }
+      }
+
+      // Writes the converted values to the objects. Run by the calling
+      // thread.
+      void write() {
+        for ( QVector<PropertyValue>::const_iterator it = values.constBegin(),
+              last = values.constEnd(); it != last; ++it ) {
+          it->entry->property.write( objects->at( it->object ), it->value );
+        }
+      }
+
+      int begin;
+      int end;
+      const QList<QObject*>* objects;
+      // what is written to the objects, when converting to them
+      const QVariantList* variants;
+      // where the objects are converted to, otherwise
+      QVariant* results;
+      const QStringList* ignoredProperties;
+      QSemaphore* done;
+      // the tables of the objects, null for null objects, and the tables
+      // those and the entries of values point to
+      QVector<const PropertyTable*> objectTables;
+      QVector<QSharedPointer<const PropertyTable> > tables;
+      QVector<PropertyValue> values;
+  };
+
+  // Splits the first count objects in chunks converted by the threads of
+  // pool, the calling thread included. The objects are read and written by
+  // the calling thread only.
+  void convertInParallel( const QList<QObject*>& objects, int count, const QVariantList* variants,
+                          QVariant* results, const QStringList* ignoredProperties, QThreadPool* pool )
+  {
+    if ( !pool )
+      pool = QThreadPool::globalInstance();
+    const int chunkCount = qBound( 1, count / minimumChunkSize, qMax( 1, pool->maxThreadCount() ) );
+
+    QSemaphore done;
+    QVector<ConversionChunk*> chunks( chunkCount );
+    for ( int i = 0; i < chunkCount; ++i ) {
+      ConversionChunk* chunk = new ConversionChunk;
+      chunk->begin = int( qint64( count ) * i / chunkCount );
+      chunk->end = int( qint64( count ) * ( i + 1 ) / chunkCount );
+      chunk->objects = &objects;
+      chunk->variants = variants;
+      chunk->results = results;
+      chunk->ignoredProperties = ignoredProperties;
+      chunk->done = &done;
+      chunks[i] = chunk;
+      chunk->prepare();
+    }
+
+    // the chunks the pool has no free thread for are converted here, so
+    // that being called from a busy pool can't deadlock
+    int started = 0;
+    for ( int i = 1; i < chunkCount; ++i ) {
+      if ( pool->tryStart( chunks.at( i ) ) )
+        ++started;
+      else
+        chunks.at( i )->convert();
+    }
+    chunks.at( 0 )->convert();
+    done.acquire( started );
+
+    if ( !results ) {
+      for ( int i = 0; i < chunkCount; ++i )
+        chunks.at( i )->write();
+    }
+    qDeleteAll( chunks );
+  }
+
+}
+
+void QObjectHelper::setPropertyTableCacheEnabled( bool enabled )
+{
+  PropertyTableCache* cache = propertyTableCache();
+  QMutexLocker locker( &cache->mutex );
+  // the tables cached so far are kept, as the serializers may still refer
+  // to them by address
+  cache->enabled = enabled;
+}
+
+bool QObjectHelper::isPropertyTableCacheEnabled()
+{
+  PropertyTableCache* cache = propertyTableCache();
+  QMutexLocker locker( &cache->mutex );
+  return cache->enabled;
+}
+
+ObjectFactory::~ObjectFactory()
+{
+}
+
 class QObjectHelper::QObjectHelperPrivate {
 };
 
@@ -45,42 +525,69 @@ QObjectHelper::~QObjectHelper()
 QVariantMap QObjectHelper::qobject2qvariant( const QObject* object,
                               const QStringList& ignoredProperties)
 {
-  QVariantMap result;
-  const QMetaObject *metaobject = object->metaObject();
-  int count = metaobject->propertyCount();
-  for (int i=0; i<count; ++i) {
-    QMetaProperty metaproperty = metaobject->property(i);
-    const char *name = metaproperty.name();
+  // reading doesn't modify the object
+  return readProperties( propertyTable( object->metaObject() ).data(),
+                         ObjectAccess( const_cast<QObject*>( object ) ), ignoredProperties );
+}
 
-    if (!metaproperty.isReadable() || ignoredProperties.contains(QLatin1String(name)))
-      continue;
+void QObjectHelper::qvariant2qobject(const QVariantMap& variant, QObject* object)
+{
+  writeProperties( variant, propertyTable( object->metaObject() ).data(), ObjectAccess( object ) );
+}
 
-    QVariant value = object->property(name);
-    result[QLatin1String(name)] = value;
- }
-  return result;
+QVariantList QObjectHelper::qobjects2qvariants( const QList<QObject*>& objects,
+                                               const QStringList& ignoredProperties,
+                                               QThreadPool* pool)
+{
+  QVector<QVariant> results( objects.size() );
+  convertInParallel( objects, objects.size(), 0, results.data(), &ignoredProperties, pool );
+  return results.toList();
 }
 
-void QObjectHelper::qvariant2qobject(const QVariantMap& variant, QObject* object)
+void QObjectHelper::qvariants2qobjects(const QVariantList& variants, const QList<QObject*>& objects,
+                                       QThreadPool* pool)
 {
-  const QMetaObject *metaobject = object->metaObject();
+  convertInParallel( objects, qMin( objects.size(), variants.size() ), &variants, 0, 0, pool );
+}
 
-  for (QVariantMap::const_iterator iter = variant.constBegin(),
-       end = variant.constEnd(); iter != end; ++iter) {
-    int pIdx = metaobject->indexOfProperty( iter.key().toLatin1() );
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+QVariantMap QObjectHelper::qgadget2qvariant( const void* gadget, const QMetaObject* metaObject,
+                                             const QStringList& ignoredProperties)
+{
+  return readProperties( propertyTable( metaObject ).data(),
+                         GadgetAccess( const_cast<void*>( gadget ) ), ignoredProperties );
+}
 
-    if ( pIdx < 0 ) {
-      continue;
-    }
+void QObjectHelper::qvariant2qgadget(const QVariantMap& variant, void* gadget, const QMetaObject* metaObject)
+{
+  writeProperties( variant, propertyTable( metaObject ).data(), GadgetAccess( gadget ) );
+}
+#endif
 
-    QMetaProperty metaproperty = metaobject->property( pIdx );
-    QVariant::Type type = metaproperty.type();
-    QVariant v( iter.value() );
-    if ( v.canConvert( type ) ) {
-      v.convert( type );
-      metaproperty.write( object, v );
-    } else if (QLatin1String("QVariant") == QLatin1String(metaproperty.typeName())) {
-     metaproperty.write( object, v );
-    }
-  }
+bool QObjectHelper::json2qobject(const QByteArray& json, QObject* object, QString* errorString)
+{
+  Q_ASSERT( object );
+  StreamReader reader( json );
+  return readDocument( reader, object, 0, errorString );
+}
+
+bool QObjectHelper::json2qobject(QIODevice* io, QObject* object, QString* errorString)
+{
+  Q_ASSERT( object );
+  StreamReader reader( io );
+  return readDocument( reader, object, 0, errorString );
+}
+
+bool QObjectHelper::json2qobjects(const QByteArray& json, ObjectFactory* factory, QString* errorString)
+{
+  Q_ASSERT( factory );
+  StreamReader reader( json );
+  return readDocument( reader, 0, factory, errorString );
+}
+
+bool QObjectHelper::json2qobjects(QIODevice* io, ObjectFactory* factory, QString* errorString)
+{
+  Q_ASSERT( factory );
+  StreamReader reader( io );
+  return readDocument( reader, 0, factory, errorString );
 }
@@ -28,10 +28,29 @@
 #include <QtCore/QVariantMap>
 
 QT_BEGIN_NAMESPACE
+class QByteArray;
+class QIODevice;
 class QObject;
+struct QMetaObject;
+class QThreadPool;
 QT_END_NAMESPACE
 
 namespace QJson {
+  /**
+  * @brief Creates the objects which the elements of a JSON array are read into.
+  * \sa QObjectHelper::json2qobjects
+  */
+  class QJSON_EXPORT ObjectFactory {
+    public:
+      virtual ~ObjectFactory();
+
+      /**
+      * Returns a new object for the next element of the array, which is
+      * owned by the caller, or 0 to stop reading with an error.
+      */
+      virtual QObject* create() = 0;
+  };
+
   /**
   * @brief Class used to convert QObject into QVariant and vivce-versa.
   * During these operations only the class attributes defined as properties will
@@ -112,6 +131,13 @@ namespace QJson {
     QObjectHelper::qvariant2qobject(variant.toMap(), &person);
     \endcode
 
+    The same can be done straight from the JSON data, without building the
+    QVariantMap first:
+    \code
+    Person person;
+    QObjectHelper::json2qobject(json, &person);
+    \endcode
+
     \sa Parser
     \sa Serializer
   */
@@ -137,6 +163,142 @@ namespace QJson {
     */
     static void qvariant2qobject(const QVariantMap& variant, QObject* object);
 
+    /**
+    * This method converts a list of QObject instances into a list of
+    * QVariantMaps, like qobject2qvariant() does for each of them. The
+    * property getters are called from the calling thread only, as they are
+    * by qobject2qvariant(), so the objects must be usable from there. For
+    * large lists, building the QVariantMaps from the values read is split
+    * in chunks run by the threads of \a pool, the calling thread included.
+    * Null objects are converted to invalid QVariants.
+    *
+    * @param objects The QObject instances to be converted.
+    * @param ignoredProperties Properties that won't be converted.
+    * @param pool The threads to use, QThreadPool::globalInstance() if null.
+    */
+    static QVariantList qobjects2qvariants( const QList<QObject*>& objects,
+                                  const QStringList& ignoredProperties = QStringList(QString(QLatin1String("objectName"))),
+                                  QThreadPool* pool = 0);
+
+    /**
+    * This method assigns each QVariantMap of \a variants to the QObject at
+    * the same position of \a objects, like qvariant2qobject() does. The
+    * property setters, and so the slots directly connected to their NOTIFY
+    * signals, are called from the calling thread only, once all the values
+    * have been converted. For large lists, converting the values to the
+    * types of the properties is split in chunks run by the threads of
+    * \a pool, the calling thread included. The objects beyond the end of
+    * \a variants are left untouched.
+    *
+    * @param variants Attributes to assign to the objects.
+    * @param objects The QObject instances to update.
+    * @param pool The threads to use, QThreadPool::globalInstance() if null.
+    */
+    static void qvariants2qobjects(const QVariantList& variants, const QList<QObject*>& objects,
+                                   QThreadPool* pool = 0);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    /**
+    * This method converts a Q_GADGET value type into a QVariantMap, like
+    * qobject2qvariant() does for QObjects. Gadgets need no heap allocation
+    * nor QObject bookkeeping, which makes them cheaper for many records.
+    *
+    * @param gadget The gadget instance to be converted.
+    * @param ignoredProperties Properties that won't be converted.
+    */
+    template <class T>
+    static QVariantMap qgadget2qvariant( const T& gadget,
+                                         const QStringList& ignoredProperties = QStringList())
+    {
+      return qgadget2qvariant( &gadget, &T::staticMetaObject, ignoredProperties );
+    }
+
+    /**
+    * This method converts a QVariantMap instance into a Q_GADGET value type
+    *
+    * @param variant Attributes to assign to the gadget.
+    * @param gadget The gadget instance to update.
+    */
+    template <class T>
+    static void qvariant2qgadget(const QVariantMap& variant, T& gadget)
+    {
+      qvariant2qgadget( variant, &gadget, &T::staticMetaObject );
+    }
+
+    /**
+    * This is an overloaded method for gadgets whose type is known only
+    * through \a metaObject.
+    */
+    static QVariantMap qgadget2qvariant( const void* gadget, const QMetaObject* metaObject,
+                                         const QStringList& ignoredProperties = QStringList());
+
+    /**
+    * This is an overloaded method for gadgets whose type is known only
+    * through \a metaObject.
+    */
+    static void qvariant2qgadget(const QVariantMap& variant, void* gadget, const QMetaObject* metaObject);
+#endif
+
+    /**
+    * This method reads a JSON object into the properties of a QObject while
+    * it's being parsed, like qvariant2qobject() but without building a
+    * QVariantMap first. The values of unknown keys are skipped without
+    * being decoded. Objects read into properties holding a non null QObject*,
+    * or with Qt 5 a pointer to a QObject subclass, are assigned to the
+    * properties of that object.
+    *
+    * @param json The JSON data, which must be an object.
+    * @param object The QObject instance to update.
+    * @param errorString if not null, set to the error message when reading fails
+    * @returns true if the document is well formed and is an object
+    */
+    static bool json2qobject(const QByteArray& json, QObject* object, QString* errorString = 0);
+
+    /**
+    * This is a method provided for convenience, which reads the JSON data
+    * from \a io.
+    * @sa json2qobject(const QByteArray&, QObject*, QString*)
+    */
+    static bool json2qobject(QIODevice* io, QObject* object, QString* errorString = 0);
+
+    /**
+    * This method reads a JSON array of objects, each of them into a new
+    * QObject returned by \a factory.
+    *
+    * @param json The JSON data, which must be an array of objects.
+    * @param factory Creates the object of each element of the array.
+    * @param errorString if not null, set to the error message when reading fails
+    * @returns true if the document is well formed and is an array of objects
+    * @sa json2qobject(const QByteArray&, QObject*, QString*)
+    */
+    static bool json2qobjects(const QByteArray& json, ObjectFactory* factory, QString* errorString = 0);
+
+    /**
+    * This is a method provided for convenience, which reads the JSON data
+    * from \a io.
+    * @sa json2qobjects(const QByteArray&, ObjectFactory*, QString*)
+    */
+    static bool json2qobjects(QIODevice* io, ObjectFactory* factory, QString* errorString = 0);
+
+    /**
+    * Sets whether the properties of each class are looked up once and
+    * cached for good, which is the default. They are cached by the address
+    * of the QMetaObject of the class, which is fine for the meta-objects
+    * generated by moc. Meta-objects built at run time, such as the ones QML
+    * creates, may be freed and their address reused by another one: disable
+    * the cache while converting objects with such meta-objects. This
+    * applies to Serializer as well.
+    *
+    * @param enabled Whether the properties are cached.
+    */
+    static void setPropertyTableCacheEnabled(bool enabled);
+
+    /**
+    * @returns whether the properties of each class are cached
+    * @sa setPropertyTableCacheEnabled()
+    */
+    static bool isPropertyTableCacheEnabled();
+
     private:
       Q_DISABLE_COPY(QObjectHelper)
       class QObjectHelperPrivate;
@@ -0,0 +1,79 @@
+/* This file is part of qjson
+  *
+  * This library is free software; you can redistribute it and/or
+  * modify it under the terms of the GNU Lesser General Public
+  * License version 2.1, as published by the Free Software Foundation.
+  *
+  *
+  * This library is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  * Lesser General Public License for more details.
+  *
+  * You should have received a copy of the GNU Lesser General Public License
+  * along with this library; see the file COPYING.LIB.  If not, write to
+  * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  * Boston, MA 02110-1301, USA.
+  */
+
+#ifndef QJSON_QOBJECTHELPER_P_H
+#define QJSON_QOBJECTHELPER_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMetaProperty>
+#include <QtCore/QMetaType>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+// The property tables shared by QObjectHelper and Serializer, not part of
+// the public API
+
+namespace QJson {
+
+  // What the conversions need to know about a property, computed once per
+  // class instead of once per object
+  struct PropertyEntry {
+    QString name;
+    QMetaProperty property;
+    QVariant::Type type;
+    bool isVariant;
+  };
+
+  struct PropertyTable {
+    // the readable properties in declaration order, with a name redeclared
+    // by a subclass once, read from the subclass
+    QVector<PropertyEntry> readable;
+    // all the properties, and the index of each of them by name
+    QVector<PropertyEntry> properties;
+    QHash<QString, int> byName;
+    // whether the table is kept in the cache, and its address is therefore
+    // the same for every object of the class
+    bool cached;
+  };
+
+  // Whether the values of \a type are QObject pointers: QObject* itself or,
+  // since Qt 5, a pointer to a registered subclass such as Person*
+  inline bool isQObjectPointer( int type )
+  {
+    if ( type == QMetaType::QObjectStar )
+      return true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return type >= QMetaType::User && ( QMetaType::typeFlags( type ) & QMetaType::PointerToQObject );
+#else
+    return false;
+#endif
+  }
+
+  // Returns the table of \a metaobject, built on first use and cached for
+  // good by address, which suits the meta-objects generated by moc as they
+  // live as long as the code of their class. While the cache is disabled
+  // with QObjectHelper::setPropertyTableCacheEnabled(), the tables are
+  // built on every call and released with the last reference instead.
+  // Safe to call from several threads at once.
+  QSharedPointer<const PropertyTable> propertyTable( const QMetaObject* metaobject );
+
+}
+
+#endif // QJSON_QOBJECTHELPER_P_H
@@ -20,10 +20,18 @@
   */
 
 #include "serializer.h"
+#include "serializer_p.h"
+#include "qobjecthelper_p.h"
 
 #include <QtCore/QDataStream>
+#include <QtCore/QObject>
 #include <QtCore/QStringList>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
 
 // cmath does #undef for isnan and isinf macroses what can be defined in math.h
 #if defined(Q_OS_SYMBIAN) || defined(Q_OS_ANDROID) || defined(Q_OS_BLACKBERRY) || defined(Q_OS_SOLARIS)
@@ -43,286 +51,952 @@
 #include <float.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define QJSON_HAVE_SSE2
+# include <emmintrin.h>
+#endif
+
 using namespace QJson;
 
-class Serializer::SerializerPrivate {
-  public:
-    SerializerPrivate() :
-      specialNumbersAllowed(false),
-      indentMode(QJson::IndentNone),
-      doublePrecision(6) {
-        errorMessage.clear();
+namespace {
+
+  // Indentation is one space per level, appended from a static buffer of
+  // spaces instead of being rebuilt character by character.
+  void appendIndent( QByteArray& out, int level )
+  {
+    static const char spaces[] =
+      "                                                                ";
+    static const int chunk = sizeof(spaces) - 1;
+    while ( level > chunk ) {
+      out.append( spaces, chunk );
+      level -= chunk;
     }
-    QString errorMessage;
-    bool specialNumbersAllowed;
-    IndentMode indentMode;
-    int doublePrecision;
+    if ( level > 0 ) {
+      out.append( spaces, level );
+    }
+  }
 
-    QByteArray serialize( const QVariant &v, bool *ok, int indentLevel = 0);
+  // Indentation policies, one per QJson::IndentMode. The serializer is
+  // instantiated once per policy, so the layout decisions are resolved at
+  // compile time rather than tested at every value.
+  struct NoIndent {
+    static void elementIndent( QByteArray&, int ) {}
+    static void openArray( QByteArray& out ) { out += "[ "; }
+    static void arraySeparator( QByteArray& out ) { out += ", "; }
+    static void closeArray( QByteArray& out, int ) { out += " ]"; }
+    static void openObject( QByteArray& out, int ) { out += "{ "; }
+    static void pairSeparator( QByteArray& out, int ) { out += ", "; }
+    static void keySeparator( QByteArray& out ) { out += " : "; }
+    static void closeObject( QByteArray& out, int ) { out += " }"; }
+  };
 
-    static QByteArray buildIndent(int spaces);
-    static QByteArray escapeString( const QString& str );
-    static QByteArray join( const QList<QByteArray>& list, const QByteArray& sep );
-    static QByteArray join( const QList<QByteArray>& list, char sep );
-};
+  struct CompactIndent {
+    static void elementIndent( QByteArray&, int ) {}
+    static void openArray( QByteArray& out ) { out += '['; }
+    static void arraySeparator( QByteArray& out ) { out += ','; }
+    static void closeArray( QByteArray& out, int ) { out += ']'; }
+    static void openObject( QByteArray& out, int ) { out += '{'; }
+    static void pairSeparator( QByteArray& out, int ) { out += ','; }
+    static void keySeparator( QByteArray& out ) { out += ':'; }
+    static void closeObject( QByteArray& out, int ) { out += '}'; }
+  };
 
-QByteArray Serializer::SerializerPrivate::join( const QList<QByteArray>& list, const QByteArray& sep ) {
-  QByteArray res;
-  Q_FOREACH( const QByteArray& i, list ) {
-    if ( !res.isEmpty() )
-      res += sep;
-    res += i;
+  // array elements on their own line, objects on a single line
+  struct MinimumIndent : NoIndent {
+    static void elementIndent( QByteArray& out, int level ) { appendIndent( out, level ); }
+    static void openArray( QByteArray& out ) { out += "[\n"; }
+    static void arraySeparator( QByteArray& out ) { out += ",\n"; }
+    static void closeArray( QByteArray& out, int level ) {
+      out += '\n';
+      appendIndent( out, level );
+      out += ']';
+    }
+  };
+
+  // like MinimumIndent, but object members start on a new line
+  struct MediumIndent : MinimumIndent {
+    static void openObject( QByteArray& out, int level ) {
+      out += "{\n";
+      appendIndent( out, level + 1 );
+    }
+    static void closeObject( QByteArray& out, int level ) {
+      out += '\n';
+      appendIndent( out, level );
+      out += '}';
+    }
+  };
+
+  // like MediumIndent, with every object member on its own line
+  struct FullIndent : MediumIndent {
+    static void pairSeparator( QByteArray& out, int level ) {
+      out += ",\n";
+      appendIndent( out, level + 1 );
+    }
+  };
+
+  template <class Indent>
+  const IndentLayout& layoutOf()
+  {
+    static const IndentLayout layout = {
+      &Indent::elementIndent,
+      &Indent::openArray,
+      &Indent::arraySeparator,
+      &Indent::closeArray,
+      &Indent::openObject,
+      &Indent::pairSeparator,
+      &Indent::keySeparator,
+      &Indent::closeObject
+    };
+    return layout;
   }
-  return res;
+
 }
 
-QByteArray Serializer::SerializerPrivate::join( const QList<QByteArray>& list, char sep ) {
-  QByteArray res;
-  Q_FOREACH( const QByteArray& i, list ) {
-    if ( !res.isEmpty() )
-      res += sep;
-    res += i;
+const IndentLayout& QJson::indentLayout( IndentMode mode )
+{
+  switch ( mode ) {
+    case QJson::IndentCompact:
+      return layoutOf<CompactIndent>();
+    case QJson::IndentMinimum:
+      return layoutOf<MinimumIndent>();
+    case QJson::IndentMedium:
+      return layoutOf<MediumIndent>();
+    case QJson::IndentFull:
+      return layoutOf<FullIndent>();
+    case QJson::IndentNone:
+    default:
+      return layoutOf<NoIndent>();
   }
-  return res;
 }
 
-QByteArray Serializer::SerializerPrivate::serialize( const QVariant &v, bool *ok, int indentLevel)
-{
-  QByteArray str;
-  const QVariant::Type type = v.type();
+namespace {
 
-  if ( ! v.isValid() ) { // invalid or null?
-    str = "null";
-  } else if (( type == QVariant::List ) || ( type == QVariant::StringList )) { // an array or a stringlist?
-    const QVariantList list = v.toList();
-    QList<QByteArray> values;
-    Q_FOREACH( const QVariant& var, list )
-    {
-      QByteArray serializedValue;
+  // Shortest round trip formatting of doubles, using the Grisu2 algorithm
+  // by Florian Loitsch ("Printing Floating-Point Numbers Quickly and
+  // Accurately with Integers", PLDI 2010), modelled after Milo Yip's
+  // implementation. It finds the shortest digit string that reads back as
+  // the same double in nearly all cases, and a correct if slightly longer
+  // one otherwise.
 
-      serializedValue = serialize( var, ok, indentLevel+1);
+  struct DiyFp {
+    DiyFp() : f(0), e(0) {}
+    DiyFp( quint64 fp, int exp ) : f(fp), e(exp) {}
 
-      if ( !*ok ) {
-        break;
-      }
-      switch(indentMode) {
-        case QJson::IndentFull :
-        case QJson::IndentMedium :
-        case QJson::IndentMinimum :
-          values << serializedValue;
-          break;
-        case QJson::IndentCompact :
-        case QJson::IndentNone :
-        default:
-          values << serializedValue.trimmed();
-          break;
+    explicit DiyFp( double d ) {
+      quint64 bits;
+      memcpy( &bits, &d, sizeof(bits) );
+      const int biasedExponent = static_cast<int>(( bits & exponentMask ) >> 52);
+      const quint64 significand = bits & significandMask;
+      if ( biasedExponent != 0 ) {
+        f = significand + hiddenBit;
+        e = biasedExponent - 1075;
+      } else {
+        f = significand;
+        e = -1074;
       }
     }
 
-    if (indentMode == QJson::IndentMedium || indentMode == QJson::IndentFull ) {
-      QByteArray indent = buildIndent(indentLevel);
-      str = indent + "[\n" + join( values, ",\n" ) + '\n' + indent + ']';
+    DiyFp operator-( const DiyFp& rhs ) const {
+      return DiyFp( f - rhs.f, e );
     }
-    else if (indentMode == QJson::IndentMinimum) {
-      QByteArray indent = buildIndent(indentLevel);
-      str = indent + "[\n" + join( values, ",\n" ) + '\n' + indent + ']';
+
+    DiyFp operator*( const DiyFp& rhs ) const {
+      const quint64 mask32 = Q_UINT64_C(0xffffffff);
+      const quint64 a = f >> 32;
+      const quint64 b = f & mask32;
+      const quint64 c = rhs.f >> 32;
+      const quint64 d = rhs.f & mask32;
+      const quint64 ac = a * c;
+      const quint64 bc = b * c;
+      const quint64 ad = a * d;
+      const quint64 bd = b * d;
+      quint64 tmp = ( bd >> 32 ) + ( ad & mask32 ) + ( bc & mask32 );
+      tmp += Q_UINT64_C(1) << 31; // round
+      return DiyFp( ac + ( ad >> 32 ) + ( bc >> 32 ) + ( tmp >> 32 ), e + rhs.e + 64 );
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str = '[' + join( values, "," ) + ']';
+
+    DiyFp normalize() const {
+      DiyFp res = *this;
+      while ( !( res.f & ( Q_UINT64_C(1) << 63 ) ) ) {
+        res.f <<= 1;
+        res.e--;
+      }
+      return res;
     }
-    else {
-      str = "[ " + join( values, ", " ) + " ]";
+
+    // the boundaries m- and m+ of the interval of real numbers which round
+    // to this double, with the exponent of the normalized m+
+    void normalizedBoundaries( DiyFp* minus, DiyFp* plus ) const {
+      DiyFp pl( ( f << 1 ) + 1, e - 1 );
+      while ( !( pl.f & ( hiddenBit << 1 ) ) ) {
+        pl.f <<= 1;
+        pl.e--;
+      }
+      pl.f <<= 10;
+      pl.e -= 10;
+      DiyFp mi = ( f == hiddenBit ) ? DiyFp( ( f << 2 ) - 1, e - 2 ) : DiyFp( ( f << 1 ) - 1, e - 1 );
+      mi.f <<= mi.e - pl.e;
+      mi.e = pl.e;
+      *plus = pl;
+      *minus = mi;
     }
 
-  } else if ( type == QVariant::Map ) { // variant is a map?
-    const QVariantMap vmap = v.toMap();
+    static const quint64 exponentMask = Q_UINT64_C(0x7ff0000000000000);
+    static const quint64 significandMask = Q_UINT64_C(0x000fffffffffffff);
+    static const quint64 hiddenBit = Q_UINT64_C(0x0010000000000000);
+
+    quint64 f;
+    int e;
+  };
+
+  // 10^k for k = -348, -340, ..., 340, normalized to 64 bit significands
+  const quint64 cachedPowersF[] = {
+    Q_UINT64_C(0xfa8fd5a0081c0288), Q_UINT64_C(0xbaaee17fa23ebf76), Q_UINT64_C(0x8b16fb203055ac76),
+    Q_UINT64_C(0xcf42894a5dce35ea), Q_UINT64_C(0x9a6bb0aa55653b2d), Q_UINT64_C(0xe61acf033d1a45df),
+    Q_UINT64_C(0xab70fe17c79ac6ca), Q_UINT64_C(0xff77b1fcbebcdc4f), Q_UINT64_C(0xbe5691ef416bd60c),
+    Q_UINT64_C(0x8dd01fad907ffc3c), Q_UINT64_C(0xd3515c2831559a83), Q_UINT64_C(0x9d71ac8fada6c9b5),
+    Q_UINT64_C(0xea9c227723ee8bcb), Q_UINT64_C(0xaecc49914078536d), Q_UINT64_C(0x823c12795db6ce57),
+    Q_UINT64_C(0xc21094364dfb5637), Q_UINT64_C(0x9096ea6f3848984f), Q_UINT64_C(0xd77485cb25823ac7),
+    Q_UINT64_C(0xa086cfcd97bf97f4), Q_UINT64_C(0xef340a98172aace5), Q_UINT64_C(0xb23867fb2a35b28e),
+    Q_UINT64_C(0x84c8d4dfd2c63f3b), Q_UINT64_C(0xc5dd44271ad3cdba), Q_UINT64_C(0x936b9fcebb25c996),
+    Q_UINT64_C(0xdbac6c247d62a584), Q_UINT64_C(0xa3ab66580d5fdaf6), Q_UINT64_C(0xf3e2f893dec3f126),
+    Q_UINT64_C(0xb5b5ada8aaff80b8), Q_UINT64_C(0x87625f056c7c4a8b), Q_UINT64_C(0xc9bcff6034c13053),
+    Q_UINT64_C(0x964e858c91ba2655), Q_UINT64_C(0xdff9772470297ebd), Q_UINT64_C(0xa6dfbd9fb8e5b88f),
+    Q_UINT64_C(0xf8a95fcf88747d94), Q_UINT64_C(0xb94470938fa89bcf), Q_UINT64_C(0x8a08f0f8bf0f156b),
+    Q_UINT64_C(0xcdb02555653131b6), Q_UINT64_C(0x993fe2c6d07b7fac), Q_UINT64_C(0xe45c10c42a2b3b06),
+    Q_UINT64_C(0xaa242499697392d3), Q_UINT64_C(0xfd87b5f28300ca0e), Q_UINT64_C(0xbce5086492111aeb),
+    Q_UINT64_C(0x8cbccc096f5088cc), Q_UINT64_C(0xd1b71758e219652c), Q_UINT64_C(0x9c40000000000000),
+    Q_UINT64_C(0xe8d4a51000000000), Q_UINT64_C(0xad78ebc5ac620000), Q_UINT64_C(0x813f3978f8940984),
+    Q_UINT64_C(0xc097ce7bc90715b3), Q_UINT64_C(0x8f7e32ce7bea5c70), Q_UINT64_C(0xd5d238a4abe98068),
+    Q_UINT64_C(0x9f4f2726179a2245), Q_UINT64_C(0xed63a231d4c4fb27), Q_UINT64_C(0xb0de65388cc8ada8),
+    Q_UINT64_C(0x83c7088e1aab65db), Q_UINT64_C(0xc45d1df942711d9a), Q_UINT64_C(0x924d692ca61be758),
+    Q_UINT64_C(0xda01ee641a708dea), Q_UINT64_C(0xa26da3999aef774a), Q_UINT64_C(0xf209787bb47d6b85),
+    Q_UINT64_C(0xb454e4a179dd1877), Q_UINT64_C(0x865b86925b9bc5c2), Q_UINT64_C(0xc83553c5c8965d3d),
+    Q_UINT64_C(0x952ab45cfa97a0b3), Q_UINT64_C(0xde469fbd99a05fe3), Q_UINT64_C(0xa59bc234db398c25),
+    Q_UINT64_C(0xf6c69a72a3989f5c), Q_UINT64_C(0xb7dcbf5354e9bece), Q_UINT64_C(0x88fcf317f22241e2),
+    Q_UINT64_C(0xcc20ce9bd35c78a5), Q_UINT64_C(0x98165af37b2153df), Q_UINT64_C(0xe2a0b5dc971f303a),
+    Q_UINT64_C(0xa8d9d1535ce3b396), Q_UINT64_C(0xfb9b7cd9a4a7443c), Q_UINT64_C(0xbb764c4ca7a44410),
+    Q_UINT64_C(0x8bab8eefb6409c1a), Q_UINT64_C(0xd01fef10a657842c), Q_UINT64_C(0x9b10a4e5e9913129),
+    Q_UINT64_C(0xe7109bfba19c0c9d), Q_UINT64_C(0xac2820d9623bf429), Q_UINT64_C(0x80444b5e7aa7cf85),
+    Q_UINT64_C(0xbf21e44003acdd2d), Q_UINT64_C(0x8e679c2f5e44ff8f), Q_UINT64_C(0xd433179d9c8cb841),
+    Q_UINT64_C(0x9e19db92b4e31ba9), Q_UINT64_C(0xeb96bf6ebadf77d9), Q_UINT64_C(0xaf87023b9bf0ee6b)
+  };
+
+  const short cachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+  };
+
+  const quint64 powersOf10[] = {
+    Q_UINT64_C(1), Q_UINT64_C(10), Q_UINT64_C(100), Q_UINT64_C(1000), Q_UINT64_C(10000),
+    Q_UINT64_C(100000), Q_UINT64_C(1000000), Q_UINT64_C(10000000), Q_UINT64_C(100000000),
+    Q_UINT64_C(1000000000), Q_UINT64_C(10000000000), Q_UINT64_C(100000000000),
+    Q_UINT64_C(1000000000000), Q_UINT64_C(10000000000000), Q_UINT64_C(100000000000000),
+    Q_UINT64_C(1000000000000000), Q_UINT64_C(10000000000000000), Q_UINT64_C(100000000000000000),
+    Q_UINT64_C(1000000000000000000), Q_UINT64_C(10000000000000000000)
+  };
 
-    if (indentMode == QJson::IndentMinimum) {
-      QByteArray indent = buildIndent(indentLevel);
-      str = indent + "{ ";
+  // a cached power c = 10^-k such that the product with a number of binary
+  // exponent e has its binary exponent in [-60, -32]
+  DiyFp cachedPower( int e, int* k )
+  {
+    const double dk = ( -61 - e ) * 0.30102999566398114 + 347; // 1 / log2(10)
+    int ik = static_cast<int>(dk);
+    if ( dk - ik > 0.0 ) {
+      ik++;
     }
-    else if (indentMode == QJson::IndentMedium || indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel);
-      QByteArray nextindent = buildIndent(indentLevel + 1);
-      str = indent + "{\n" + nextindent;
+    const unsigned index = static_cast<unsigned>(( ik >> 3 ) + 1);
+    *k = -( -348 + static_cast<int>(index << 3) );
+    return DiyFp( cachedPowersF[index], cachedPowersE[index] );
+  }
+
+  int countDecimalDigits( quint32 n )
+  {
+    int digits = 1;
+    while ( digits < 10 && n >= powersOf10[digits] ) {
+      ++digits;
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str = "{";
+    return digits;
+  }
+
+  void grisuRound( char* buffer, int len, quint64 delta, quint64 rest, quint64 tenKappa, quint64 wpw )
+  {
+    while ( rest < wpw && delta - rest >= tenKappa &&
+            ( rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw ) ) {
+      buffer[len - 1]--;
+      rest += tenKappa;
     }
-    else {
-      str = "{ ";
+  }
+
+  void digitGen( const DiyFp& w, const DiyFp& mp, quint64 delta, char* buffer, int* len, int* k )
+  {
+    const DiyFp one( Q_UINT64_C(1) << -mp.e, mp.e );
+    const DiyFp wpw = mp - w;
+    quint32 p1 = static_cast<quint32>(mp.f >> -one.e);
+    quint64 p2 = mp.f & ( one.f - 1 );
+    int kappa = countDecimalDigits( p1 );
+    *len = 0;
+
+    while ( kappa > 0 ) {
+      const quint32 d = static_cast<quint32>(p1 / powersOf10[kappa - 1]);
+      p1 = static_cast<quint32>(p1 % powersOf10[kappa - 1]);
+      if ( d || *len ) {
+        buffer[(*len)++] = static_cast<char>('0' + d);
+      }
+      kappa--;
+      const quint64 tmp = ( static_cast<quint64>(p1) << -one.e ) + p2;
+      if ( tmp <= delta ) {
+        *k += kappa;
+        grisuRound( buffer, *len, delta, tmp, powersOf10[kappa] << -one.e, wpw.f );
+        return;
+      }
     }
 
-    QList<QByteArray> pairs;
-    for (QVariantMap::const_iterator it = vmap.begin(), end = vmap.end(); it != end; ++it) {
-      indentLevel++;
-      QByteArray serializedValue = serialize( it.value(), ok, indentLevel);
-      indentLevel--;
-      if ( !*ok ) {
-        break;
+    for (;;) {
+      p2 *= 10;
+      delta *= 10;
+      const char d = static_cast<char>(p2 >> -one.e);
+      if ( d || *len ) {
+        buffer[(*len)++] = static_cast<char>('0' + d);
       }
-      QByteArray key   = escapeString( it.key() );
-      QByteArray value = serializedValue.trimmed();
-      if (indentMode == QJson::IndentCompact) {
-        pairs << key + ':' + value;
-      } else {
-        pairs << key + " : " + value;
+      p2 &= one.f - 1;
+      kappa--;
+      if ( p2 < delta ) {
+        *k += kappa;
+        // delta grows tenfold with each digit while p2 stays below 2^60,
+        // so at most 17 digits follow the point
+        Q_ASSERT( -kappa < 20 );
+        grisuRound( buffer, *len, delta, p2, one.f, wpw.f * powersOf10[-kappa] );
+        return;
       }
     }
+  }
+
+  // Writes the shortest decimal digits of the positive, finite value to
+  // buffer, which is value = digits * 10^k.
+  void grisu2( double value, char* buffer, int* len, int* k )
+  {
+    const DiyFp v( value );
+    DiyFp wm, wp;
+    v.normalizedBoundaries( &wm, &wp );
+
+    const DiyFp cmk = cachedPower( wp.e, k );
+    const DiyFp w = v.normalize() * cmk;
+    DiyFp wPlus = wp * cmk;
+    DiyFp wMinus = wm * cmk;
+    wMinus.f++;
+    wPlus.f--;
+    digitGen( w, wPlus, wPlus.f - wMinus.f, buffer, len, k );
+  }
 
-    if (indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel + 1);
-      str += join( pairs, ",\n" + indent);
+  // Appends a finite double in its shortest round trip form. Numbers are
+  // written in fixed notation when that is reasonably short (the same rule
+  // as JavaScript's Number.toString()) and in exponential notation
+  // otherwise; the result always contains '.' or 'e' so that it reads
+  // back as a double.
+  void appendShortestDouble( QByteArray& out, double value )
+  {
+    if ( value == 0 ) {
+      out += ( 1 / value < 0 ) ? "-0.0" : "0.0";
+      return;
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str += join( pairs, ',' );
+    if ( value < 0 ) {
+      out += '-';
+      value = -value;
     }
-    else {
-      str += join( pairs, ", " );
+
+    char digits[20];
+    int length;
+    int k;
+    grisu2( value, digits, &length, &k );
+
+    // position of the decimal point relative to the first digit
+    const int point = length + k;
+    char buffer[32];
+    char* p = buffer;
+
+    if ( length <= point && point <= 21 ) {
+      // integral: 1234e2 -> 123400.0
+      memcpy( p, digits, length );
+      p += length;
+      memset( p, '0', point - length );
+      p += point - length;
+      *p++ = '.';
+      *p++ = '0';
+    } else if ( 0 < point && point <= 21 ) {
+      // 1234e-2 -> 12.34
+      memcpy( p, digits, point );
+      p += point;
+      *p++ = '.';
+      memcpy( p, digits + point, length - point );
+      p += length - point;
+    } else if ( -6 < point && point <= 0 ) {
+      // 1234e-6 -> 0.001234
+      *p++ = '0';
+      *p++ = '.';
+      memset( p, '0', -point );
+      p += -point;
+      memcpy( p, digits, length );
+      p += length;
+    } else {
+      // 1234e30 -> 1.234e+33
+      *p++ = digits[0];
+      if ( length > 1 ) {
+        *p++ = '.';
+        memcpy( p, digits + 1, length - 1 );
+        p += length - 1;
+      }
+      *p++ = 'e';
+      int exponent = point - 1;
+      if ( exponent < 0 ) {
+        *p++ = '-';
+        exponent = -exponent;
+      } else {
+        *p++ = '+';
+      }
+      if ( exponent >= 100 ) {
+        *p++ = static_cast<char>('0' + exponent / 100);
+        exponent %= 100;
+        *p++ = static_cast<char>('0' + exponent / 10);
+      } else if ( exponent >= 10 ) {
+        *p++ = static_cast<char>('0' + exponent / 10);
+      }
+      *p++ = static_cast<char>('0' + exponent % 10);
     }
+    out.append( buffer, static_cast<int>(p - buffer) );
+  }
+
+}
+
+namespace QJson {
+
+  const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 
-    if (indentMode == QJson::IndentMedium || indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel);
-      str += '\n' + indent + '}';
+  // Appends an integer, producing two digits per division.
+  void appendInteger( QByteArray& out, quint64 value, bool negative )
+  {
+    char buffer[21];
+    char* p = buffer + sizeof(buffer);
+    while ( value >= 100 ) {
+      const unsigned i = static_cast<unsigned>(value % 100) * 2;
+      value /= 100;
+      *--p = digitPairs[i + 1];
+      *--p = digitPairs[i];
+    }
+    if ( value >= 10 ) {
+      const unsigned i = static_cast<unsigned>(value) * 2;
+      *--p = digitPairs[i + 1];
+      *--p = digitPairs[i];
+    } else {
+      *--p = static_cast<char>('0' + value);
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str += '}';
+    if ( negative ) {
+      *--p = '-';
     }
-    else {
-      str += " }";
+    out.append( p, static_cast<int>(buffer + sizeof(buffer) - p) );
+  }
+
+  void appendInteger( QByteArray& out, qint64 value )
+  {
+    if ( value < 0 ) {
+      // negating in unsigned arithmetic is safe for the minimum value too
+      appendInteger( out, 0 - static_cast<quint64>(value), true );
+    } else {
+      appendInteger( out, static_cast<quint64>(value), false );
     }
+  }
 
-  } else if ( type == QVariant::Hash ) { // variant is a hash?
-    const QVariantHash vhash = v.toHash();
+}
 
-    if (indentMode == QJson::IndentMinimum) {
-      QByteArray indent = buildIndent(indentLevel);
-      str = indent + "{ ";
+bool QJson::appendDouble( QByteArray& str, double value, int precision, bool specialNumbers )
+{
+#if defined _WIN32 && !defined(Q_OS_SYMBIAN)
+  const bool special = _isnan(value) || !_finite(value);
+#elif defined(Q_OS_SYMBIAN) || defined(Q_OS_ANDROID) || defined(Q_OS_BLACKBERRY) || defined(Q_OS_SOLARIS)
+  const bool special = isnan(value) || isinf(value);
+#else
+  const bool special = std::isnan(value) || std::isinf(value);
+#endif
+  if (special) {
+    if (!specialNumbers) {
+      return false;
+    }
+#if defined _WIN32 && !defined(Q_OS_SYMBIAN)
+    if (_isnan(value)) {
+#elif defined(Q_OS_SYMBIAN) || defined(Q_OS_ANDROID) || defined(Q_OS_BLACKBERRY) || defined(Q_OS_SOLARIS)
+    if (isnan(value)) {
+#else
+    if (std::isnan(value)) {
+#endif
+      str += "NaN";
+    } else {
+      if (value<0) {
+        str += '-';
+      }
+      str += "Infinity";
     }
-    else if (indentMode == QJson::IndentMedium || indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel);
-      QByteArray nextindent = buildIndent(indentLevel + 1);
-      str = indent + "{\n" + nextindent;
+  } else if ( precision == Serializer::ShortestDoublePrecision ) {
+    appendShortestDouble( str, value );
+  } else {
+    const QByteArray number = QByteArray::number( value , 'g', precision);
+    str += number;
+    if( !number.contains( '.' ) && !number.contains( 'e' ) ) {
+      str += ".0";
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str = "{";
+  }
+  return true;
+}
+
+namespace {
+
+  bool hashKeyLessThan( const QVariantHash::const_iterator& a, const QVariantHash::const_iterator& b )
+  {
+    return a.key() < b.key();
+  }
+
+}
+
+class Serializer::SerializerPrivate {
+  public:
+    SerializerPrivate() :
+      specialNumbersAllowed(false),
+      indentMode(QJson::IndentNone),
+      doublePrecision(6),
+      maxDepth(0),
+      escapeNonAscii(true),
+      sortedKeys(false) {
+        errorMessage.clear();
+        ignoredProperties << QLatin1String("objectName");
     }
-    else {
-      str = "{ ";
+    ~SerializerPrivate() {
+      qDeleteAll(frames);
     }
+    QString errorMessage;
+    bool specialNumbersAllowed;
+    IndentMode indentMode;
+    int doublePrecision;
+    int maxDepth;
+    bool escapeNonAscii;
+    bool sortedKeys;
+    QStringList ignoredProperties;
+    // which readable properties of each class are in ignoredProperties,
+    // for the tables which stay in the cache
+    QHash<const PropertyTable*, QVector<bool> > ignoredMasks;
 
-    QList<QByteArray> pairs;
-    for (QVariantHash::const_iterator it = vhash.begin(), end = vhash.end(); it != end; ++it) {
-      QByteArray serializedValue = serialize( it.value(), ok, indentLevel + 1);
+    // An array or an object whose members are being written. Frames are
+    // heap allocated and recycled, and iterate in place over the containers
+    // held by the QVariants being serialized, which stay put until the end.
+    struct Frame {
+      enum Kind { List, StringList, Map, Hash, SortedHash, Sequential, Associative, Object };
+      Kind kind;
+      int level;
+      bool first;
+      QVariantList::const_iterator listIt, listEnd;
+      QStringList::const_iterator stringIt, stringEnd;
+      QVariantMap::const_iterator mapIt, mapEnd;
+      QVariantHash::const_iterator hashIt, hashEnd;
+      // the members of a hash ordered by key, the values aren't copied
+      QVector<QVariantHash::const_iterator> sortedHash;
+      int sortedIndex;
+      // the properties of a QObject, read one at a time
+      const QObject* object;
+      QSharedPointer<const PropertyTable> table;
+      QVector<bool> ignored;
+      int propertyIndex;
+      // the value being written, when it isn't stored in the container
+      QVariant item;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+      // other registered containers, which hand out their values by copy
+      QSequentialIterable::const_iterator* sequentialIt;
+      QSequentialIterable::const_iterator* sequentialEnd;
+      QAssociativeIterable::const_iterator* associativeIt;
+      QAssociativeIterable::const_iterator* associativeEnd;
 
-      if ( !*ok ) {
-        break;
+      Frame() : sequentialIt(0), sequentialEnd(0), associativeIt(0), associativeEnd(0) {}
+      ~Frame() { release(); }
+
+      void release() {
+        delete sequentialIt;
+        delete sequentialEnd;
+        delete associativeIt;
+        delete associativeEnd;
+        sequentialIt = sequentialEnd = 0;
+        associativeIt = associativeEnd = 0;
+        item = QVariant();
+        table.clear();
+        ignored = QVector<bool>();
+        sortedHash.resize( 0 );
       }
-      QByteArray key   = escapeString( it.key() );
-      QByteArray value = serializedValue.trimmed();
-      if (indentMode == QJson::IndentCompact) {
-        pairs << key + ':' + value;
-      } else {
-        pairs << key + " : " + value;
+#else
+      void release() {
+        item = QVariant();
+        table.clear();
+        ignored = QVector<bool>();
+        sortedHash.resize( 0 );
       }
-    }
+#endif
+    };
+    QList<Frame*> frames;
 
-    if (indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel + 1);
-      str += join( pairs, ",\n" + indent);
-    }
-    else if (indentMode == QJson::IndentCompact) {
-      str += join( pairs, ',' );
-    }
-    else {
-      str += join( pairs, ", " );
-    }
+    QByteArray serialize( const QVariant &v, bool *ok );
+    template <class Indent, bool SpecialNumbers>
+    QByteArray serialize( const QVariant &v, bool *ok );
+    template <bool SpecialNumbers>
+    bool serializeScalar( const QVariant &v, QByteArray &out );
+    template <bool SpecialNumbers>
+    bool serializeDouble( double value, QByteArray &out );
+    bool serializeOther( const QVariant &v, QByteArray &out );
+    bool serializeString( const QString& value, QByteArray &out );
+    bool depthExceeded( int level );
+    bool objectIsOpen( const QObject* object, int depth );
+    Frame* pushFrame( int depth );
+    QVector<bool> ignoredMask( const PropertyTable* table );
+};
+
+bool Serializer::SerializerPrivate::depthExceeded( int level )
+{
+  // containers at indentation level 0 are at depth 1
+  if ( maxDepth > 0 && level >= maxDepth ) {
+    errorMessage += QLatin1String("Maximum depth exceeded\n");
+    return true;
+  }
+  return false;
+}
 
-    if (indentMode == QJson::IndentMedium || indentMode == QJson::IndentFull) {
-      QByteArray indent = buildIndent(indentLevel);
-      str += '\n' + indent + '}';
+// Properties can point back to an object being written, e.g. to a parent,
+// which would otherwise be followed forever
+bool Serializer::SerializerPrivate::objectIsOpen( const QObject* object, int depth )
+{
+  for ( int i = 0; i < depth; ++i ) {
+    const Frame* frame = frames.at( i );
+    if ( frame->kind == Frame::Object && frame->object == object ) {
+      errorMessage += QLatin1String("Attempt to serialize an object which contains itself\n");
+      return true;
     }
-    else if (indentMode == QJson::IndentCompact) {
-      str += '}';
+  }
+  return false;
+}
+
+Serializer::SerializerPrivate::Frame* Serializer::SerializerPrivate::pushFrame( int depth )
+{
+  if ( depth == frames.size() ) {
+    frames.append( new Frame );
+  }
+  Frame* frame = frames.at( depth );
+  frame->first = true;
+  return frame;
+}
+
+QVector<bool> Serializer::SerializerPrivate::ignoredMask( const PropertyTable* table )
+{
+  QHash<const PropertyTable*, QVector<bool> >::const_iterator it = ignoredMasks.constFind( table );
+  if ( it != ignoredMasks.constEnd() ) {
+    return it.value();
+  }
+
+  const QVector<PropertyEntry>& readable = table->readable;
+  QVector<bool> mask( readable.size(), false );
+  for ( int i = 0; i < readable.size(); ++i ) {
+    mask[i] = ignoredProperties.contains( readable.at( i ).name );
+  }
+  // the address of the other tables may be reused by another class
+  if ( table->cached ) {
+    ignoredMasks.insert( table, mask );
+  }
+  return mask;
+}
+
+QByteArray Serializer::SerializerPrivate::serialize( const QVariant &v, bool *ok )
+{
+  switch ( indentMode ) {
+    case QJson::IndentCompact:
+      return specialNumbersAllowed ? serialize<CompactIndent, true>( v, ok )
+                                   : serialize<CompactIndent, false>( v, ok );
+    case QJson::IndentMinimum:
+      return specialNumbersAllowed ? serialize<MinimumIndent, true>( v, ok )
+                                   : serialize<MinimumIndent, false>( v, ok );
+    case QJson::IndentMedium:
+      return specialNumbersAllowed ? serialize<MediumIndent, true>( v, ok )
+                                   : serialize<MediumIndent, false>( v, ok );
+    case QJson::IndentFull:
+      return specialNumbersAllowed ? serialize<FullIndent, true>( v, ok )
+                                   : serialize<FullIndent, false>( v, ok );
+    case QJson::IndentNone:
+    default:
+      return specialNumbersAllowed ? serialize<NoIndent, true>( v, ok )
+                                   : serialize<NoIndent, false>( v, ok );
+  }
+}
+
+template <class Indent, bool SpecialNumbers>
+QByteArray Serializer::SerializerPrivate::serialize( const QVariant &v, bool *ok )
+{
+  // The document is walked depth first with an explicit stack of frames
+  // instead of recursion, so arbitrarily deep documents can't overflow the
+  // call stack, and everything is appended to a single output buffer.
+  QByteArray str;
+
+  const QVariant* current = &v;
+  int level = 0;
+  bool isArrayElement = false;
+  int depth = 0;
+
+  while ( current ) {
+    // array elements are placed on their own line, object members are not
+    if ( isArrayElement ) {
+      Indent::elementIndent( str, level );
     }
-    else {
-      str += " }";
+
+    const int type = current->userType();
+    Frame::Kind kind = Frame::List;
+    if ( type == QMetaType::QVariantList ) { // an array?
+      kind = Frame::List;
+    } else if ( type == QMetaType::QStringList ) { // a stringlist?
+      kind = Frame::StringList;
+    } else if ( type == QMetaType::QVariantMap ) { // a map?
+      kind = Frame::Map;
+    } else if ( type == QMetaType::QVariantHash ) { // a hash?
+      kind = Frame::Hash;
+    } else if ( isQObjectPointer( type ) &&
+                *static_cast<QObject* const*>(current->constData()) ) { // a QObject?
+      kind = Frame::Object;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    } else if ( type >= QMetaType::User &&
+                ( current->canConvert<QVariantHash>() || current->canConvert<QVariantMap>() ) ) { // another associative container?
+      kind = Frame::Associative;
+    } else if ( type >= QMetaType::User && current->canConvert<QVariantList>() ) { // another sequential container?
+      kind = Frame::Sequential;
+#endif
+    } else {
+      if ( !serializeScalar<SpecialNumbers>( *current, str ) ) {
+        *ok = false;
+        break;
+      }
+      current = 0;
     }
 
-  } else {
-    // Add indent, we may need to remove it later for some layouts
-    switch(indentMode) {
-      case QJson::IndentFull :
-      case QJson::IndentMedium :
-      case QJson::IndentMinimum :
-        str += buildIndent(indentLevel);
+    if ( current ) {
+      if ( depthExceeded( level ) ) {
+        *ok = false;
         break;
-      case QJson::IndentCompact :
-      case QJson::IndentNone :
-      default:
+      }
+      if ( kind == Frame::Object && objectIsOpen( *static_cast<QObject* const*>(current->constData()), depth ) ) {
+        *ok = false;
         break;
+      }
+      Frame* frame = pushFrame( depth++ );
+      frame->kind = kind;
+      frame->level = level;
+      switch ( kind ) {
+        case Frame::List: {
+          const QVariantList* list = static_cast<const QVariantList*>(current->constData());
+          frame->listIt = list->constBegin();
+          frame->listEnd = list->constEnd();
+          break;
+        }
+        case Frame::StringList: {
+          const QStringList* list = static_cast<const QStringList*>(current->constData());
+          frame->stringIt = list->constBegin();
+          frame->stringEnd = list->constEnd();
+          break;
+        }
+        case Frame::Map: {
+          const QVariantMap* map = static_cast<const QVariantMap*>(current->constData());
+          frame->mapIt = map->constBegin();
+          frame->mapEnd = map->constEnd();
+          break;
+        }
+        case Frame::Hash: {
+          const QVariantHash* hash = static_cast<const QVariantHash*>(current->constData());
+          if ( sortedKeys ) {
+            frame->kind = Frame::SortedHash;
+            frame->sortedHash.reserve( hash->size() );
+            for ( QVariantHash::const_iterator it = hash->constBegin(), end = hash->constEnd(); it != end; ++it ) {
+              frame->sortedHash.append( it );
+            }
+            std::sort( frame->sortedHash.begin(), frame->sortedHash.end(), hashKeyLessThan );
+            frame->sortedIndex = 0;
+          } else {
+            frame->hashIt = hash->constBegin();
+            frame->hashEnd = hash->constEnd();
+          }
+          break;
+        }
+        case Frame::Object: {
+          frame->object = *static_cast<QObject* const*>(current->constData());
+          frame->table = propertyTable( frame->object->metaObject() );
+          frame->ignored = ignoredMask( frame->table.data() );
+          frame->propertyIndex = 0;
+          break;
+        }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+        case Frame::Sequential: {
+          const QSequentialIterable iterable = current->value<QSequentialIterable>();
+          frame->sequentialIt = new QSequentialIterable::const_iterator( iterable.begin() );
+          frame->sequentialEnd = new QSequentialIterable::const_iterator( iterable.end() );
+          break;
+        }
+        case Frame::Associative: {
+          const QAssociativeIterable iterable = current->value<QAssociativeIterable>();
+          frame->associativeIt = new QAssociativeIterable::const_iterator( iterable.begin() );
+          frame->associativeEnd = new QAssociativeIterable::const_iterator( iterable.end() );
+          break;
+        }
+#endif
+        default:
+          break;
+      }
+
+      if ( kind == Frame::Map || kind == Frame::Hash || kind == Frame::Associative || kind == Frame::Object ) {
+        Indent::openObject( str, level );
+      } else {
+        Indent::openArray( str );
+      }
     }
 
-    if (( type == QVariant::String ) ||  ( type == QVariant::ByteArray )) { // a string or a byte array?
-      str += escapeString( v.toString() );
-    } else if (( type == QVariant::Double) || ((QMetaType::Type)type == QMetaType::Float)) { // a double or a float?
-      const double value = v.toDouble();
-  #if defined _WIN32 && !defined(Q_OS_SYMBIAN)
-      const bool special = _isnan(value) || !_finite(value);
-  #elif defined(Q_OS_SYMBIAN) || defined(Q_OS_ANDROID) || defined(Q_OS_BLACKBERRY) || defined(Q_OS_SOLARIS)
-      const bool special = isnan(value) || isinf(value);
-  #else
-      const bool special = std::isnan(value) || std::isinf(value);
-  #endif
-      if (special) {
-        if (specialNumbersAllowed) {
-  #if defined _WIN32 && !defined(Q_OS_SYMBIAN)
-          if (_isnan(value)) {
-  #elif defined(Q_OS_SYMBIAN) || defined(Q_OS_ANDROID) || defined(Q_OS_BLACKBERRY) || defined(Q_OS_SOLARIS)
-          if (isnan(value)) {
-  #else
-          if (std::isnan(value)) {
-  #endif
-            str += "NaN";
-          } else {
-            if (value<0) {
-              str += '-';
-            }
-            str += "Infinity";
+    // move on to the next value, closing the containers which are done
+    current = 0;
+    while ( depth > 0 && !current ) {
+      Frame* frame = frames.at( depth - 1 );
+      const int frameLevel = frame->level;
+
+      if ( frame->kind == Frame::List || frame->kind == Frame::StringList || frame->kind == Frame::Sequential ) {
+        bool atEnd;
+        if ( frame->kind == Frame::List ) {
+          atEnd = frame->listIt == frame->listEnd;
+        } else if ( frame->kind == Frame::StringList ) {
+          atEnd = frame->stringIt == frame->stringEnd;
+        } else {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+          atEnd = *frame->sequentialIt == *frame->sequentialEnd;
+#else
+          atEnd = true;
+#endif
+        }
+
+        if ( atEnd ) {
+          Indent::closeArray( str, frameLevel );
+          frame->release();
+          --depth;
+          continue;
+        }
+
+        if ( !frame->first ) {
+          Indent::arraySeparator( str );
+        }
+        frame->first = false;
+
+        if ( frame->kind == Frame::StringList ) {
+          // strings are written right away, there's nothing to descend into
+          Indent::elementIndent( str, frameLevel + 1 );
+          if ( !serializeString( *frame->stringIt, str ) ) {
+            *ok = false;
+            break;
+          }
+          ++frame->stringIt;
+          continue;
+        }
+
+        if ( frame->kind == Frame::List ) {
+          current = &*frame->listIt;
+          ++frame->listIt;
+        } else {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+          frame->item = **frame->sequentialIt;
+          current = &frame->item;
+          ++*frame->sequentialIt;
+#endif
+        }
+        isArrayElement = true;
+      } else {
+        const QString* key = 0;
+        QString convertedKey;
+        if ( frame->kind == Frame::Map ) {
+          if ( frame->mapIt != frame->mapEnd ) {
+            key = &frame->mapIt.key();
+            current = &frame->mapIt.value();
+            ++frame->mapIt;
+          }
+        } else if ( frame->kind == Frame::Hash ) {
+          if ( frame->hashIt != frame->hashEnd ) {
+            key = &frame->hashIt.key();
+            current = &frame->hashIt.value();
+            ++frame->hashIt;
+          }
+        } else if ( frame->kind == Frame::SortedHash ) {
+          if ( frame->sortedIndex < frame->sortedHash.size() ) {
+            const QVariantHash::const_iterator it = frame->sortedHash.at( frame->sortedIndex++ );
+            key = &it.key();
+            current = &it.value();
+          }
+        } else if ( frame->kind == Frame::Object ) {
+          const QVector<PropertyEntry>& readable = frame->table->readable;
+          while ( frame->propertyIndex < readable.size() && frame->ignored.at( frame->propertyIndex ) ) {
+            ++frame->propertyIndex;
+          }
+          if ( frame->propertyIndex < readable.size() ) {
+            const PropertyEntry& entry = readable.at( frame->propertyIndex++ );
+            key = &entry.name;
+            frame->item = entry.property.read( frame->object );
+            current = &frame->item;
           }
         } else {
-          errorMessage += QLatin1String("Attempt to write NaN or infinity, which is not supported by json\n");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+          if ( *frame->associativeIt != *frame->associativeEnd ) {
+            convertedKey = frame->associativeIt->key().toString();
+            key = &convertedKey;
+            frame->item = frame->associativeIt->value();
+            current = &frame->item;
+            ++*frame->associativeIt;
+          }
+#endif
+        }
+
+        if ( !current ) {
+          Indent::closeObject( str, frameLevel );
+          frame->release();
+          --depth;
+          continue;
+        }
+
+        if ( !frame->first ) {
+          Indent::pairSeparator( str, frameLevel );
+        }
+        frame->first = false;
+        if ( !serializeString( *key, str ) ) {
           *ok = false;
-      }
-      } else {
-        str = QByteArray::number( value , 'g', doublePrecision);
-        if( !str.contains( '.' ) && !str.contains( 'e' ) ) {
-          str += ".0";
+          current = 0;
+          break;
         }
+        Indent::keySeparator( str );
+        isArrayElement = false;
       }
-    } else if ( type == QVariant::Bool ) { // boolean value?
-      str += ( v.toBool() ? "true" : "false" );
-    } else if ( type == QVariant::ULongLong ) { // large unsigned number?
-      str += QByteArray::number( v.value<qulonglong>() );
-    } else if ( type == QVariant::UInt ) { // unsigned int number?
-      str += QByteArray::number( v.value<quint32>() );
-    } else if ( v.canConvert<qlonglong>() ) { // any signed number?
-      str += QByteArray::number( v.value<qlonglong>() );
-    } else if ( v.canConvert<int>() ) { // unsigned short number?
-      str += QByteArray::number( v.value<int>() );
-    } else if ( v.canConvert<QString>() ){ // can value be converted to string?
-      // this will catch QDate, QDateTime, QUrl, ...
-      str += escapeString( v.toString() );
-      //TODO: catch other values like QImage, QRect, ...
-    } else {
-      *ok = false;
-      errorMessage += QLatin1String("Cannot serialize ");
-      errorMessage += v.toString();
-      errorMessage += QLatin1String(" because type ");
-      errorMessage += QLatin1String(v.typeName());
-      errorMessage += QLatin1String(" is not supported by QJson\n");
+      level = frameLevel + 1;
     }
   }
+
+  // release the frames left over by an error
+  for ( int i = 0; i < depth; ++i ) {
+    frames.at( i )->release();
+  }
+
   if ( *ok )
   {
     return str;
@@ -331,59 +1005,272 @@ QByteArray Serializer::SerializerPrivate::serialize( const QVariant &v, bool *ok
     return QByteArray();
 }
 
-QByteArray Serializer::SerializerPrivate::buildIndent(int spaces)
+template <bool SpecialNumbers>
+bool Serializer::SerializerPrivate::serializeScalar( const QVariant &v, QByteArray &str )
 {
-   QByteArray indent;
-   if (spaces < 0) {
-     spaces = 0;
-   }
-   for (int i = 0; i < spaces; i++ ) {
-     indent += ' ';
-   }
-   return indent;
+  // the core types are read directly from the variant, everything else
+  // goes through QVariant's conversions
+  switch ( v.userType() ) {
+    case QMetaType::QString:
+      return serializeString( *static_cast<const QString*>(v.constData()), str );
+    case QMetaType::Double:
+      return serializeDouble<SpecialNumbers>( *static_cast<const double*>(v.constData()), str );
+    case QMetaType::Float:
+      return serializeDouble<SpecialNumbers>( *static_cast<const float*>(v.constData()), str );
+    case QMetaType::Bool:
+      str += ( *static_cast<const bool*>(v.constData()) ? "true" : "false" );
+      return true;
+    case QMetaType::Int:
+      appendInteger( str, *static_cast<const int*>(v.constData()) );
+      return true;
+    case QMetaType::UInt:
+      appendInteger( str, *static_cast<const uint*>(v.constData()), false );
+      return true;
+    case QMetaType::LongLong:
+      appendInteger( str, *static_cast<const qlonglong*>(v.constData()) );
+      return true;
+    case QMetaType::ULongLong:
+      appendInteger( str, *static_cast<const qulonglong*>(v.constData()), false );
+      return true;
+    case QMetaType::QObjectStar: // only null objects get here
+      str += "null";
+      return true;
+    default:
+      if ( isQObjectPointer( v.userType() ) ) { // a null subclass pointer
+        str += "null";
+        return true;
+      }
+      return serializeOther( v, str );
+  }
 }
 
-QByteArray Serializer::SerializerPrivate::escapeString( const QString& str )
+template <bool SpecialNumbers>
+bool Serializer::SerializerPrivate::serializeDouble( double value, QByteArray &str )
 {
-  QByteArray result;
-  result.reserve(str.size() + 2);
-  result.append('\"');
-  for (QString::const_iterator it = str.begin(), end = str.end(); it != end; ++it) {
-    ushort unicode = it->unicode();
-    switch ( unicode ) {
-      case '\"':
-        result.append("\\\"");
-        break;
-      case '\\':
-        result.append("\\\\");
-        break;
-      case '\b':
-        result.append("\\b");
-        break;
-      case '\f':
-        result.append("\\f");
-        break;
-      case '\n':
-        result.append("\\n");
-        break;
-      case '\r':
-        result.append("\\r");
-        break;
-      case '\t':
-        result.append("\\t");
-        break;
-      default:
-        if ( unicode > 0x1F && unicode < 128 ) {
-          result.append(static_cast<char>(unicode));
-        } else {
-          char escaped[7];
-          qsnprintf(escaped, sizeof(escaped)/sizeof(char), "\\u%04x", unicode);
-          result.append(escaped);
+  if ( !appendDouble( str, value, doublePrecision, SpecialNumbers ) ) {
+    errorMessage += QLatin1String("Attempt to write NaN or infinity, which is not supported by json\n");
+    return false;
+  }
+  return true;
+}
+
+bool Serializer::SerializerPrivate::serializeString( const QString& value, QByteArray &str )
+{
+  if ( !escapeString( value, str, escapeNonAscii ) ) {
+    errorMessage += QLatin1String("The output is too big\n");
+    return false;
+  }
+  return true;
+}
+
+bool Serializer::SerializerPrivate::serializeOther( const QVariant &v, QByteArray &str )
+{
+  if ( ! v.isValid() ) { // invalid or null?
+    str += "null";
+  } else if ( v.type() == QVariant::ByteArray ) { // a byte array?
+    return serializeString( v.toString(), str );
+  } else if ( v.canConvert<qlonglong>() ) { // any signed number?
+    appendInteger( str, v.value<qlonglong>() );
+  } else if ( v.canConvert<int>() ) { // unsigned short number?
+    appendInteger( str, v.value<int>() );
+  } else if ( v.canConvert<QString>() ){ // can value be converted to string?
+    // this will catch QDate, QDateTime, QUrl, ...
+    return serializeString( v.toString(), str );
+    //TODO: catch other values like QImage, QRect, ...
+  } else {
+    errorMessage += QLatin1String("Cannot serialize ");
+    errorMessage += v.toString();
+    errorMessage += QLatin1String(" because type ");
+    errorMessage += QLatin1String(v.typeName());
+    errorMessage += QLatin1String(" is not supported by QJson\n");
+    return false;
+  }
+  return true;
+}
+
+namespace {
+
+  // How each ASCII character is written inside a string: 0 when it is
+  // copied as is, 'u' when it needs a \u00XX escape, otherwise the letter
+  // of its two character escape sequence.
+  const char escapeTable[128] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+     0,   0,  '"',  0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, '\\',  0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+  };
+
+  const char hexDigits[] = "0123456789abcdef";
+
+  // Returns the number of leading characters in [begin, end) which can be
+  // copied without escaping, i.e. printable ASCII other than '"' and '\'.
+  inline int safeAsciiRun( const ushort* begin, const ushort* end )
+  {
+    const ushort* it = begin;
+#ifdef QJSON_HAVE_SSE2
+    const __m128i nonAscii = _mm_set1_epi16( static_cast<short>(0xff80) );
+    const __m128i space = _mm_set1_epi16( 0x20 );
+    const __m128i quote = _mm_set1_epi16( '"' );
+    const __m128i backslash = _mm_set1_epi16( '\\' );
+    const __m128i zero = _mm_setzero_si128();
+    while ( end - it >= 8 ) {
+      const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(it) );
+      // characters from 0x8000 up compare as negative, they are caught by
+      // the non-ASCII test anyway
+      __m128i unsafe = _mm_cmplt_epi16( chunk, space );
+      unsafe = _mm_or_si128( unsafe, _mm_cmpeq_epi16( chunk, quote ) );
+      unsafe = _mm_or_si128( unsafe, _mm_cmpeq_epi16( chunk, backslash ) );
+      unsafe = _mm_or_si128( unsafe, _mm_xor_si128( _mm_cmpeq_epi16( _mm_and_si128( chunk, nonAscii ), zero ),
+                                                    _mm_cmpeq_epi16( zero, zero ) ) );
+      const int mask = _mm_movemask_epi8( unsafe );
+      if ( mask ) {
+        // two mask bits per character
+        int i = 0;
+        while ( !( mask & ( 1 << ( 2 * i ) ) ) ) {
+          ++i;
         }
+        return static_cast<int>(it - begin) + i;
+      }
+      it += 8;
+    }
+#endif
+    while ( it != end && *it < 128 && !escapeTable[*it] ) {
+      ++it;
+    }
+    return static_cast<int>(it - begin);
+  }
+
+  // Narrows count ASCII characters from UTF-16 to bytes.
+  inline char* copyAscii( const ushort* src, int count, char* out )
+  {
+#ifdef QJSON_HAVE_SSE2
+    while ( count >= 8 ) {
+      const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(src) );
+      _mm_storel_epi64( reinterpret_cast<__m128i*>(out), _mm_packus_epi16( chunk, chunk ) );
+      src += 8;
+      out += 8;
+      count -= 8;
+    }
+#endif
+    while ( count-- > 0 ) {
+      *out++ = static_cast<char>(*src++);
+    }
+    return out;
+  }
+
+  inline char* writeUnicodeEscape( ushort unicode, char* out )
+  {
+    *out++ = '\\';
+    *out++ = 'u';
+    *out++ = hexDigits[( unicode >> 12 ) & 0xf];
+    *out++ = hexDigits[( unicode >> 8 ) & 0xf];
+    *out++ = hexDigits[( unicode >> 4 ) & 0xf];
+    *out++ = hexDigits[unicode & 0xf];
+    return out;
+  }
+
+  // Transcodes the run of non-ASCII characters starting at it to UTF-8,
+  // leaving it on the first ASCII character. Surrogates which are not part
+  // of a pair can't be represented in UTF-8 and are written as escapes.
+  inline char* transcodeUtf8( const ushort*& it, const ushort* end, char* out )
+  {
+    while ( it != end && *it >= 0x80 ) {
+      const uint unicode = *it++;
+      if ( unicode < 0x800 ) {
+        *out++ = static_cast<char>(0xc0 | ( unicode >> 6 ));
+        *out++ = static_cast<char>(0x80 | ( unicode & 0x3f ));
+      } else if ( unicode < 0xd800 || unicode > 0xdfff ) {
+        *out++ = static_cast<char>(0xe0 | ( unicode >> 12 ));
+        *out++ = static_cast<char>(0x80 | ( ( unicode >> 6 ) & 0x3f ));
+        *out++ = static_cast<char>(0x80 | ( unicode & 0x3f ));
+      } else if ( unicode < 0xdc00 && it != end && *it >= 0xdc00 && *it <= 0xdfff ) {
+        const uint codePoint = 0x10000 + ( ( unicode - 0xd800 ) << 10 ) + ( *it++ - 0xdc00 );
+        *out++ = static_cast<char>(0xf0 | ( codePoint >> 18 ));
+        *out++ = static_cast<char>(0x80 | ( ( codePoint >> 12 ) & 0x3f ));
+        *out++ = static_cast<char>(0x80 | ( ( codePoint >> 6 ) & 0x3f ));
+        *out++ = static_cast<char>(0x80 | ( codePoint & 0x3f ));
+      } else {
+        out = writeUnicodeEscape( static_cast<ushort>(unicode), out );
+      }
+    }
+    return out;
+  }
+
+  // Escapes the characters in [it, end) to out, which must have room for
+  // six bytes per character
+  inline char* escapeBlock( const ushort*& it, const ushort* end, char* dst, bool escapeNonAscii )
+  {
+    while ( it != end ) {
+      const int run = safeAsciiRun( it, end );
+      dst = copyAscii( it, run, dst );
+      it += run;
+      if ( it == end ) {
+        break;
+      }
+
+      if ( *it >= 128 && !escapeNonAscii ) {
+        dst = transcodeUtf8( it, end, dst );
+        continue;
+      }
+
+      const ushort unicode = *it++;
+      const char escape = unicode < 128 ? escapeTable[unicode] : 'u';
+      if ( escape == 'u' ) {
+        dst = writeUnicodeEscape( unicode, dst );
+      } else {
+        *dst++ = '\\';
+        *dst++ = escape;
+      }
     }
+    return dst;
   }
-  result.append('\"');
-  return result;
+
+}
+
+bool QJson::escapeString( const QString& str, QByteArray& out, bool escapeNonAscii )
+{
+  // QByteArray holds a little less than INT_MAX bytes, its header included
+  static const qint64 maxSize = std::numeric_limits<int>::max() - 64;
+  // the input is escaped one block at a time, so that the worst case which
+  // is reserved for (every character written as \uXXXX, UTF-8 never needs
+  // more than three bytes per UTF-16 code unit) stays small
+  static const int blockSize = 4096;
+
+  const int start = out.size();
+  const ushort* it = str.utf16();
+  const ushort* const end = it + str.size();
+  int written = start;
+
+  do {
+    const ushort* blockEnd = end - it > blockSize ? it + blockSize : end;
+    // keep surrogate pairs in one block
+    if ( blockEnd != end && *( blockEnd - 1 ) >= 0xd800 && *( blockEnd - 1 ) < 0xdc00 ) {
+      ++blockEnd;
+    }
+
+    // room for both quotes, they're written in the first and last block
+    const qint64 needed = qint64( written ) + 6 * qint64( blockEnd - it ) + 2;
+    if ( needed > maxSize ) {
+      out.resize( start );
+      return false;
+    }
+    out.resize( static_cast<int>(needed) );
+    char* const base = out.data();
+    char* dst = base + written;
+    if ( written == start ) {
+      *dst++ = '\"';
+    }
+    dst = escapeBlock( it, blockEnd, dst, escapeNonAscii );
+    written = static_cast<int>(dst - base);
+  } while ( it != end );
+
+  out.data()[written++] = '\"';
+  out.resize( written );
+  return true;
 }
 
 Serializer::Serializer()
@@ -443,6 +1330,39 @@ QByteArray Serializer::serialize( const QVariant &v, bool *ok)
   return d->serialize(v, ok);
 }
 
+QByteArray Serializer::serialize( const QObject* object, bool *ok)
+{
+  if ( !object ) {
+    d->errorMessage = QLatin1String("Attempt to serialize a null object");
+    if (ok) {
+      *ok = false;
+    }
+    return QByteArray();
+  }
+
+  return serialize( QVariant::fromValue( const_cast<QObject*>( object ) ), ok );
+}
+
+QByteArray Serializer::serialize( const QList<QObject*>& objects, bool *ok)
+{
+  QVariantList list;
+  list.reserve( objects.size() );
+  for ( QList<QObject*>::const_iterator it = objects.constBegin(), end = objects.constEnd(); it != end; ++it ) {
+    list.append( QVariant::fromValue( *it ) );
+  }
+
+  return serialize( list, ok );
+}
+
+void QJson::Serializer::setIgnoredProperties(const QStringList& properties) {
+  d->ignoredProperties = properties;
+  d->ignoredMasks.clear();
+}
+
+QStringList QJson::Serializer::ignoredProperties() const {
+  return d->ignoredProperties;
+}
+
 void QJson::Serializer::allowSpecialNumbers(bool allow) {
   d->specialNumbersAllowed = allow;
 }
@@ -459,6 +1379,30 @@ void QJson::Serializer::setDoublePrecision(int precision) {
   d->doublePrecision = precision;
 }
 
+void QJson::Serializer::setMaxDepth(int depth) {
+  d->maxDepth = depth;
+}
+
+void QJson::Serializer::setSortedKeys(bool sorted) {
+  d->sortedKeys = sorted;
+}
+
+bool QJson::Serializer::sortedKeys() const {
+  return d->sortedKeys;
+}
+
+void QJson::Serializer::setEscapeNonAscii(bool escape) {
+  d->escapeNonAscii = escape;
+}
+
+bool QJson::Serializer::escapeNonAscii() const {
+  return d->escapeNonAscii;
+}
+
+int QJson::Serializer::maxDepth() const {
+  return d->maxDepth;
+}
+
 IndentMode QJson::Serializer::indentMode() const {
   return d->indentMode;
 }
@@ -23,8 +23,12 @@
 
 #include "qjson_export.h"
 
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+
 QT_BEGIN_NAMESPACE
 class QIODevice;
+class QObject;
 class QString;
 class QVariant;
 QT_END_NAMESPACE
@@ -188,6 +192,39 @@ namespace QJson {
       */
     QByteArray serialize( const QVariant& variant, bool *ok);
 
+    /**
+      * Serializes the readable properties of \a object as a JSON object,
+      * reading them through the meta-object system and writing them out
+      * directly, without building a QVariantMap first. The result is the
+      * same as serializing QObjectHelper::qobject2qvariant(), except that
+      * the properties are written in declaration order.
+      * Properties holding a QObject*, or with Qt 5 a pointer to a QObject
+      * subclass, are written as nested objects, an object found again
+      * inside itself is reported as an error.
+      *
+      * @param object The object to serialize
+      * @param ok if a conversion error occurs, *ok is set to false; otherwise *ok is set to true
+      * \sa setIgnoredProperties
+      */
+    QByteArray serialize( const QObject* object, bool *ok);
+
+    /**
+      * Serializes \a objects as a JSON array of objects.
+      * @sa serialize(const QObject*, bool*)
+      */
+    QByteArray serialize( const QList<QObject*>& objects, bool *ok);
+
+    /**
+     * set the properties which aren't written when serializing a QObject,
+     * by default "objectName"
+     */
+    void setIgnoredProperties(const QStringList& properties);
+
+    /**
+     * Returns the properties which aren't written when serializing a QObject
+     */
+    QStringList ignoredProperties() const;
+
     /**
      * Allow or disallow writing of NaN and/or Infinity (as an extension to QJson)
      */
@@ -204,12 +241,57 @@ namespace QJson {
     void setIndentMode(IndentMode mode = QJson::IndentNone);
 
 
+    /**
+     * Value for setDoublePrecision() selecting the shortest representation
+     * which reads back as exactly the same double
+     */
+    enum { ShortestDoublePrecision = -1 };
+
     /**
     * set double precision used while converting Double
     * \sa QByteArray::number
+    * \sa ShortestDoublePrecision
     */
     void setDoublePrecision(int precision);
 
+    /**
+     * set the maximum nesting level of arrays and objects, deeper documents
+     * are not serialized and an error is reported.
+     * 0 (the default) means no limit
+     */
+    void setMaxDepth(int depth);
+
+    /**
+     * Returns the maximum nesting level of arrays and objects, 0 if there's no limit
+     */
+    int maxDepth() const;
+
+    /**
+     * Write the members of QVariantHash objects ordered by key, so that
+     * equal documents always produce the same output. QVariantMap objects
+     * are always ordered. Sorting is done on references to the members and
+     * costs O(n log n) per hash; it is disabled by default.
+     */
+    void setSortedKeys(bool sorted);
+
+    /**
+     * Returns whether the members of QVariantHash objects are ordered by key
+     */
+    bool sortedKeys() const;
+
+    /**
+     * Write characters outside of the ASCII range as \\uXXXX escape sequences
+     * (the default) or, when \a escape is false, as raw UTF-8. Quotes,
+     * backslashes and control characters are always escaped.
+     * Raw UTF-8 output is considerably smaller for non-English text.
+     */
+    void setEscapeNonAscii(bool escape);
+
+    /**
+     * Returns whether characters outside of the ASCII range are escaped
+     */
+    bool escapeNonAscii() const;
+
     /**
      * Returns one of the indentation modes defined in QJson::IndentMode
      */
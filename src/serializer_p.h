@@ -0,0 +1,59 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QJSON_SERIALIZER_P_H
+#define QJSON_SERIALIZER_P_H
+
+#include "serializer.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+// Output primitives shared by Serializer and StreamWriter, so that both
+// produce exactly the same text. They are not part of the public API.
+
+namespace QJson {
+
+  // The layout of one IndentMode; level is the indentation level of the
+  // container being written, or of the element for elementIndent
+  struct IndentLayout {
+    void (*elementIndent)( QByteArray& out, int level );
+    void (*openArray)( QByteArray& out );
+    void (*arraySeparator)( QByteArray& out );
+    void (*closeArray)( QByteArray& out, int level );
+    void (*openObject)( QByteArray& out, int level );
+    void (*pairSeparator)( QByteArray& out, int level );
+    void (*keySeparator)( QByteArray& out );
+    void (*closeObject)( QByteArray& out, int level );
+  };
+
+  const IndentLayout& indentLayout( IndentMode mode );
+
+  // Appends str as a quoted JSON string, returns false, leaving out as it
+  // was, if the result doesn't fit in a QByteArray
+  bool escapeString( const QString& str, QByteArray& out, bool escapeNonAscii );
+
+  void appendInteger( QByteArray& out, quint64 value, bool negative );
+  void appendInteger( QByteArray& out, qint64 value );
+
+  // Appends a double with the given precision or Serializer::ShortestDoublePrecision.
+  // Returns false for NaN and infinities unless specialNumbers is set.
+  bool appendDouble( QByteArray& out, double value, int precision, bool specialNumbers );
+}
+
+#endif // QJSON_SERIALIZER_P_H
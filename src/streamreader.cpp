@@ -0,0 +1,241 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "streamreader.h"
+#include "json_parser.hh"
+#include "json_scanner.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QStack>
+
+using namespace QJson;
+
+typedef yy::json_parser::token Token;
+
+class StreamReader::StreamReaderPrivate {
+  public:
+    StreamReaderPrivate() :
+      m_scanner(0),
+      m_tokenType(StreamReader::NoToken),
+      m_afterValue(false),
+      m_error(false),
+      m_errorLine(0)
+    {
+    }
+
+    ~StreamReaderPrivate()
+    {
+      delete m_scanner;
+    }
+
+    int nextToken();
+    StreamReader::TokenType readValue(int token);
+    StreamReader::TokenType unexpected(int token);
+    StreamReader::TokenType setError(const QString& message);
+
+    QByteArray m_data;
+    JSonScanner* m_scanner;
+    YYSTYPE m_value;
+    yy::location m_location;
+    QString m_name;
+    StreamReader::TokenType m_tokenType;
+    // one entry for each open container, true for objects
+    QStack<bool> m_containers;
+    // false right after the start of the document or of a container
+    bool m_afterValue;
+    bool m_error;
+    QString m_errorString;
+    int m_errorLine;
+};
+
+int StreamReader::StreamReaderPrivate::nextToken()
+{
+  m_value.clear();
+  return m_scanner->yylex(&m_value, &m_location);
+}
+
+StreamReader::TokenType StreamReader::StreamReaderPrivate::readValue(int token)
+{
+  switch (token) {
+    case Token::SQUARE_BRACKET_OPEN:
+      m_containers.push(false);
+      m_afterValue = false;
+      return m_tokenType = StreamReader::StartArray;
+    case Token::CURLY_BRACKET_OPEN:
+      m_containers.push(true);
+      m_afterValue = false;
+      return m_tokenType = StreamReader::StartObject;
+    case Token::STRING:
+      m_tokenType = StreamReader::String;
+      break;
+    case Token::NUMBER:
+      m_tokenType = StreamReader::Number;
+      break;
+    case Token::TRUE_VAL:
+    case Token::FALSE_VAL:
+      m_tokenType = StreamReader::Bool;
+      break;
+    case Token::NULL_VAL:
+      m_tokenType = StreamReader::Null;
+      break;
+    default:
+      return unexpected(token);
+  }
+  m_afterValue = true;
+  return m_tokenType;
+}
+
+StreamReader::TokenType StreamReader::StreamReaderPrivate::unexpected(int token)
+{
+  // the scanner knows better why the input was rejected
+  if (!m_scanner->errorString().isEmpty())
+    return setError(m_scanner->errorString());
+  if (token == Token::END)
+    return setError(QLatin1String("Unexpected end of document"));
+  if (token == Token::INVALID || token < 0)
+    return setError(QLatin1String("Invalid token"));
+  return setError(QLatin1String("Unexpected token"));
+}
+
+StreamReader::TokenType StreamReader::StreamReaderPrivate::setError(const QString& message)
+{
+  m_error = true;
+  m_errorString = message;
+  m_errorLine = m_location.end.line;
+  m_value.clear();
+  m_name.clear();
+  return m_tokenType = StreamReader::Invalid;
+}
+
+StreamReader::StreamReader(const QByteArray& data)
+  : d(new StreamReaderPrivate)
+{
+  // keep a reference, so that the data can be scanned in place
+  d->m_data = data;
+  d->m_scanner = new JSonScanner(d->m_data.constData(), d->m_data.size());
+}
+
+StreamReader::StreamReader(QIODevice* io)
+  : d(new StreamReaderPrivate)
+{
+  d->m_scanner = new JSonScanner(io);
+  if (!io->isOpen() && !io->open(QIODevice::ReadOnly))
+    d->setError(QLatin1String("Error opening device"));
+}
+
+StreamReader::~StreamReader()
+{
+  delete d;
+}
+
+StreamReader::TokenType StreamReader::readNext()
+{
+  switch (d->m_tokenType) {
+    case NoToken:
+      return d->m_tokenType = StartDocument;
+    case Invalid:
+    case EndDocument:
+      return d->m_tokenType;
+    default:
+      break;
+  }
+
+  d->m_name.clear();
+  int token = d->nextToken();
+
+  if (d->m_containers.isEmpty()) {
+    if (!d->m_afterValue)
+      return d->readValue(token);
+    if (token != Token::END)
+      return d->unexpected(token);
+    return d->m_tokenType = EndDocument;
+  }
+
+  const bool inObject = d->m_containers.top();
+  if (token == (inObject ? Token::CURLY_BRACKET_CLOSE : Token::SQUARE_BRACKET_CLOSE)) {
+    d->m_containers.pop();
+    d->m_afterValue = true;
+    return d->m_tokenType = inObject ? EndObject : EndArray;
+  }
+
+  if (d->m_afterValue) {
+    if (token != Token::COMMA)
+      return d->unexpected(token);
+    token = d->nextToken();
+  }
+
+  if (inObject) {
+    if (token != Token::STRING)
+      return d->unexpected(token);
+    d->m_name = d->m_value.toString();
+    token = d->nextToken();
+    if (token != Token::COLON)
+      return d->unexpected(token);
+    token = d->nextToken();
+  }
+
+  return d->readValue(token);
+}
+
+StreamReader::TokenType StreamReader::tokenType() const
+{
+  return d->m_tokenType;
+}
+
+bool StreamReader::atEnd() const
+{
+  return d->m_tokenType == EndDocument || d->m_tokenType == Invalid;
+}
+
+const QString& StreamReader::name() const
+{
+  return d->m_name;
+}
+
+const QVariant& StreamReader::value() const
+{
+  return d->m_value;
+}
+
+void StreamReader::skipCurrentElement()
+{
+  if (d->m_tokenType != StartArray && d->m_tokenType != StartObject)
+    return;
+
+  // nothing inside is returned to the caller, so don't decode it
+  const int depth = d->m_containers.size();
+  d->m_scanner->setValidateOnly(true);
+  while (readNext() != Invalid && d->m_containers.size() >= depth) {
+  }
+  d->m_scanner->setValidateOnly(false);
+}
+
+bool StreamReader::hasError() const
+{
+  return d->m_error;
+}
+
+QString StreamReader::errorString() const
+{
+  return d->m_errorString;
+}
+
+int StreamReader::errorLine() const
+{
+  return d->m_errorLine;
+}
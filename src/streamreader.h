@@ -0,0 +1,150 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QJSON_STREAMREADER_H
+#define QJSON_STREAMREADER_H
+
+#include "qjson_export.h"
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+class QIODevice;
+class QString;
+class QVariant;
+QT_END_NAMESPACE
+
+namespace QJson {
+
+  /**
+  * @brief Reads a JSON document one token at a time.
+  *
+  * StreamReader works like QXmlStreamReader: every call to readNext()
+  * advances to the next token of the document, no in-memory representation
+  * of the whole document is ever built. The reader checks that the document
+  * is well formed as it goes.
+  *
+  * Usage:
+  *
+  * \code
+  * QJson::StreamReader reader(json);
+  * while (reader.readNext() != QJson::StreamReader::EndDocument) {
+  *   if (reader.hasError()) {
+  *     qCritical() << "Line" << reader.errorLine() << ":" << reader.errorString();
+  *     break;
+  *   }
+  *   if (reader.name() == QLatin1String("payload"))
+  *     reader.skipCurrentElement();
+  *   else if (reader.tokenType() == QJson::StreamReader::Number)
+  *     qDebug() << reader.name() << reader.value().toDouble();
+  * }
+  * \endcode
+  *
+  * Members of an object are reported as their value token, with the key
+  * available through name().
+  */
+  class QJSON_EXPORT StreamReader {
+    public:
+      enum TokenType {
+        NoToken,
+        Invalid,
+        StartDocument,
+        EndDocument,
+        StartArray,
+        EndArray,
+        StartObject,
+        EndObject,
+        String,
+        Number,
+        Bool,
+        Null
+      };
+
+      /**
+      * Creates a reader for the JSON document contained in \a data
+      */
+      explicit StreamReader(const QByteArray& data);
+
+      /**
+      * Creates a reader for the JSON document read from \a io. The device is
+      * opened if needed and read as tokens are requested, it must stay valid
+      * as long as the reader is used.
+      */
+      explicit StreamReader(QIODevice* io);
+
+      ~StreamReader();
+
+      /**
+      * Reads the next token and returns its type. Once the end of the
+      * document or an error is reached, the same token is returned again.
+      */
+      TokenType readNext();
+
+      /**
+      * @returns the type of the current token
+      */
+      TokenType tokenType() const;
+
+      /**
+      * @returns true once the end of the document or an error has been reached
+      */
+      bool atEnd() const;
+
+      /**
+      * @returns the key of the current token if it is the value of an object
+      * member, or an empty string otherwise. The reference is valid until
+      * the next call to readNext()
+      */
+      const QString& name() const;
+
+      /**
+      * @returns the value of the current String, Number, Bool or Null token,
+      * an invalid QVariant for the other tokens. The reference is valid
+      * until the next call to readNext()
+      */
+      const QVariant& value() const;
+
+      /**
+      * If the current token is StartArray or StartObject, reads until the
+      * matching EndArray or EndObject. The content is checked but not
+      * decoded, so skipping is cheaper than reading it.
+      */
+      void skipCurrentElement();
+
+      /**
+      * @returns true if the document is not well formed
+      */
+      bool hasError() const;
+
+      /**
+      * @returns the error message, an empty string if there's no error
+      */
+      QString errorString() const;
+
+      /**
+      * @returns the line of the document where the error occurred
+      */
+      int errorLine() const;
+
+    private:
+      Q_DISABLE_COPY(StreamReader)
+      class StreamReaderPrivate;
+      StreamReaderPrivate* const d;
+  };
+}
+
+#endif // QJSON_STREAMREADER_H
@@ -0,0 +1,357 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "streamwriter.h"
+#include "serializer_p.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QVector>
+
+using namespace QJson;
+
+// The output for a device is handed over once it grows past this size
+static const int FLUSH_THRESHOLD = 16384;
+
+class StreamWriter::StreamWriterPrivate {
+  public:
+    StreamWriterPrivate() :
+      io(0),
+      out(&buffer),
+      layout(&indentLayout(QJson::IndentNone)),
+      indentMode(QJson::IndentNone),
+      specialNumbersAllowed(false),
+      doublePrecision(6),
+      escapeNonAscii(true),
+      keyWritten(false),
+      documentDone(false),
+      error(false) {
+    }
+
+    // An array or an object being written
+    struct Frame {
+      bool object;
+      bool first;
+    };
+
+    bool beginValue();
+    void endValue();
+    void writeBuffer();
+    void setError( const char* message );
+
+    QIODevice* io;
+    QByteArray buffer;
+    QByteArray* out;
+    const IndentLayout* layout;
+    IndentMode indentMode;
+    bool specialNumbersAllowed;
+    int doublePrecision;
+    bool escapeNonAscii;
+    // the open containers, the indentation level of each is its index
+    QVector<Frame> frames;
+    bool keyWritten;
+    bool documentDone;
+    bool error;
+    QString errorMessage;
+};
+
+// Checks that a value can be written here and writes what precedes it
+bool StreamWriter::StreamWriterPrivate::beginValue()
+{
+  if ( error ) {
+    return false;
+  }
+
+  if ( frames.isEmpty() ) {
+    if ( documentDone ) {
+      setError( "The document has a single top-level value" );
+      return false;
+    }
+    return true;
+  }
+
+  Frame& frame = frames.last();
+  if ( frame.object ) {
+    if ( !keyWritten ) {
+      setError( "An object member needs a key" );
+      return false;
+    }
+    keyWritten = false;
+    return true;
+  }
+
+  // array elements are placed on their own line, object members are not
+  if ( !frame.first ) {
+    layout->arraySeparator( *out );
+  }
+  frame.first = false;
+  layout->elementIndent( *out, frames.size() );
+  return true;
+}
+
+void StreamWriter::StreamWriterPrivate::endValue()
+{
+  if ( frames.isEmpty() ) {
+    documentDone = true;
+  }
+  if ( io && buffer.size() >= FLUSH_THRESHOLD ) {
+    writeBuffer();
+  }
+}
+
+void StreamWriter::StreamWriterPrivate::writeBuffer()
+{
+  if ( io->write( buffer ) != buffer.size() ) {
+    setError( "Something went wrong while writing to IO device" );
+  }
+  buffer.resize( 0 );
+}
+
+void StreamWriter::StreamWriterPrivate::setError( const char* message )
+{
+  error = true;
+  errorMessage = QLatin1String( message );
+}
+
+StreamWriter::StreamWriter( QByteArray* data )
+  : d( new StreamWriterPrivate )
+{
+  d->out = data;
+}
+
+StreamWriter::StreamWriter( QIODevice* io )
+  : d( new StreamWriterPrivate )
+{
+  d->io = io;
+  if ( !io->isOpen() && !io->open( QIODevice::WriteOnly ) ) {
+    d->setError( "Error opening device" );
+  } else if ( !io->isWritable() ) {
+    d->setError( "Device is not writable" );
+  }
+}
+
+StreamWriter::~StreamWriter()
+{
+  if ( !d->error ) {
+    flush();
+  }
+  delete d;
+}
+
+void StreamWriter::setIndentMode( IndentMode mode )
+{
+  d->indentMode = mode;
+  d->layout = &indentLayout( mode );
+}
+
+IndentMode StreamWriter::indentMode() const
+{
+  return d->indentMode;
+}
+
+void StreamWriter::allowSpecialNumbers( bool allow )
+{
+  d->specialNumbersAllowed = allow;
+}
+
+bool StreamWriter::specialNumbersAllowed() const
+{
+  return d->specialNumbersAllowed;
+}
+
+void StreamWriter::setDoublePrecision( int precision )
+{
+  d->doublePrecision = precision;
+}
+
+void StreamWriter::setEscapeNonAscii( bool escape )
+{
+  d->escapeNonAscii = escape;
+}
+
+bool StreamWriter::escapeNonAscii() const
+{
+  return d->escapeNonAscii;
+}
+
+void StreamWriter::beginArray()
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  d->layout->openArray( *d->out );
+  const StreamWriterPrivate::Frame frame = { false, true };
+  d->frames.append( frame );
+}
+
+void StreamWriter::endArray()
+{
+  if ( d->error ) {
+    return;
+  }
+  if ( d->frames.isEmpty() || d->frames.last().object ) {
+    d->setError( "endArray() doesn't match an open array" );
+    return;
+  }
+  d->frames.removeLast();
+  d->layout->closeArray( *d->out, d->frames.size() );
+  d->endValue();
+}
+
+void StreamWriter::beginObject()
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  d->layout->openObject( *d->out, d->frames.size() );
+  const StreamWriterPrivate::Frame frame = { true, true };
+  d->frames.append( frame );
+}
+
+void StreamWriter::endObject()
+{
+  if ( d->error ) {
+    return;
+  }
+  if ( d->frames.isEmpty() || !d->frames.last().object ) {
+    d->setError( "endObject() doesn't match an open object" );
+    return;
+  }
+  if ( d->keyWritten ) {
+    d->setError( "The last key of the object has no value" );
+    return;
+  }
+  d->frames.removeLast();
+  d->layout->closeObject( *d->out, d->frames.size() );
+  d->endValue();
+}
+
+void StreamWriter::key( const QString& name )
+{
+  if ( d->error ) {
+    return;
+  }
+  if ( d->frames.isEmpty() || !d->frames.last().object || d->keyWritten ) {
+    d->setError( "A key can only start an object member" );
+    return;
+  }
+
+  StreamWriterPrivate::Frame& frame = d->frames.last();
+  if ( !frame.first ) {
+    d->layout->pairSeparator( *d->out, d->frames.size() - 1 );
+  }
+  frame.first = false;
+  if ( !escapeString( name, *d->out, d->escapeNonAscii ) ) {
+    d->setError( "The output is too big" );
+    return;
+  }
+  d->layout->keySeparator( *d->out );
+  d->keyWritten = true;
+}
+
+void StreamWriter::value( const QString& value )
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  if ( !escapeString( value, *d->out, d->escapeNonAscii ) ) {
+    d->setError( "The output is too big" );
+    return;
+  }
+  d->endValue();
+}
+
+void StreamWriter::value( const char* value )
+{
+  this->value( QString::fromUtf8( value ) );
+}
+
+void StreamWriter::value( bool value )
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  *d->out += ( value ? "true" : "false" );
+  d->endValue();
+}
+
+void StreamWriter::value( int value )
+{
+  this->value( static_cast<qlonglong>( value ) );
+}
+
+void StreamWriter::value( uint value )
+{
+  this->value( static_cast<qulonglong>( value ) );
+}
+
+void StreamWriter::value( qlonglong value )
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  appendInteger( *d->out, value );
+  d->endValue();
+}
+
+void StreamWriter::value( qulonglong value )
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  appendInteger( *d->out, value, false );
+  d->endValue();
+}
+
+void StreamWriter::value( double value )
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  if ( !appendDouble( *d->out, value, d->doublePrecision, d->specialNumbersAllowed ) ) {
+    d->setError( "Attempt to write NaN or infinity, which is not supported by json" );
+    return;
+  }
+  d->endValue();
+}
+
+void StreamWriter::nullValue()
+{
+  if ( !d->beginValue() ) {
+    return;
+  }
+  *d->out += "null";
+  d->endValue();
+}
+
+void StreamWriter::flush()
+{
+  if ( d->io && !d->buffer.isEmpty() ) {
+    d->writeBuffer();
+  }
+}
+
+bool StreamWriter::hasError() const
+{
+  return d->error;
+}
+
+QString StreamWriter::errorString() const
+{
+  return d->errorMessage;
+}
@@ -0,0 +1,164 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QJSON_STREAMWRITER_H
+#define QJSON_STREAMWRITER_H
+
+#include "qjson_export.h"
+#include "serializer.h"
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+class QIODevice;
+class QString;
+QT_END_NAMESPACE
+
+namespace QJson {
+
+  /**
+  * @brief Writes a JSON document one value at a time.
+  *
+  * StreamWriter works like QXmlStreamWriter: the document is written as the
+  * methods are called, without building a QVariant tree first. The output
+  * is the same Serializer would produce for the equivalent QVariant, using
+  * the same indentation modes, escaping and number formatting.
+  *
+  * Usage:
+  *
+  * \code
+  * QByteArray json;
+  * QJson::StreamWriter writer(&json);
+  * writer.beginObject();
+  * writer.key(QLatin1String("name"));
+  * writer.value(QLatin1String("Bob"));
+  * writer.key(QLatin1String("scores"));
+  * writer.beginArray();
+  * writer.value(1);
+  * writer.value(2.5);
+  * writer.endArray();
+  * writer.endObject();
+  * \endcode
+  *
+  * Calls which would produce a document that is not well formed, such as a
+  * value without a key inside an object, put the writer in an error state
+  * and are ignored, as is everything after them.
+  */
+  class QJSON_EXPORT StreamWriter {
+    public:
+      /**
+      * Creates a writer appending to \a data
+      */
+      explicit StreamWriter(QByteArray* data);
+
+      /**
+      * Creates a writer writing to \a io, which is opened if needed. The
+      * output is buffered and written to the device in chunks.
+      */
+      explicit StreamWriter(QIODevice* io);
+
+      /**
+      * Writes the buffered output to the device
+      */
+      ~StreamWriter();
+
+      /**
+      * set output indentation mode as defined in QJson::IndentMode
+      */
+      void setIndentMode(IndentMode mode = QJson::IndentNone);
+
+      /**
+      * Returns one of the indentation modes defined in QJson::IndentMode
+      */
+      IndentMode indentMode() const;
+
+      /**
+      * Allow or disallow writing of NaN and/or Infinity (as an extension to QJson)
+      */
+      void allowSpecialNumbers(bool allow);
+
+      /**
+      * Is Nan and/or Infinity allowed?
+      */
+      bool specialNumbersAllowed() const;
+
+      /**
+      * set double precision used while converting Double
+      * \sa Serializer::setDoublePrecision
+      */
+      void setDoublePrecision(int precision);
+
+      /**
+      * Write characters outside of the ASCII range as \\uXXXX escape sequences
+      * (the default) or as raw UTF-8
+      * \sa Serializer::setEscapeNonAscii
+      */
+      void setEscapeNonAscii(bool escape);
+
+      /**
+      * Returns whether characters outside of the ASCII range are escaped
+      */
+      bool escapeNonAscii() const;
+
+      void beginArray();
+      void endArray();
+      void beginObject();
+      void endObject();
+
+      /**
+      * Writes the key of the next object member, which must be followed by
+      * its value
+      */
+      void key(const QString& name);
+
+      void value(const QString& value);
+      /**
+      * Writes a string given in UTF-8
+      */
+      void value(const char* value);
+      void value(bool value);
+      void value(int value);
+      void value(uint value);
+      void value(qlonglong value);
+      void value(qulonglong value);
+      void value(double value);
+      void nullValue();
+
+      /**
+      * Writes the buffered output to the device
+      */
+      void flush();
+
+      /**
+      * @returns true if a call would have produced an invalid document, or
+      * if writing to the device failed
+      */
+      bool hasError() const;
+
+      /**
+      * Returns the error message
+      */
+      QString errorString() const;
+
+    private:
+      Q_DISABLE_COPY(StreamWriter)
+      class StreamWriterPrivate;
+      StreamWriterPrivate* const d;
+  };
+}
+
+#endif // QJSON_STREAMWRITER_H
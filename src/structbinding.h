@@ -0,0 +1,311 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef QJSON_STRUCTBINDING_H
+#define QJSON_STRUCTBINDING_H
+
+#include "streamreader.h"
+#include "streamwriter.h"
+
+#include <limits>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+
+/**
+ * @file structbinding.h
+ *
+ * Reads and writes plain structs directly from and to JSON, without a
+ * QObject, QVariant containers or meta-object lookups. The members of a
+ * struct are declared once by specializing QJson::Fields:
+ *
+ * \code
+ * struct Person {
+ *   QString name;
+ *   int age;
+ *   QList<QString> tags;
+ * };
+ *
+ * namespace QJson {
+ *   template <> struct Fields<Person> {
+ *     template <class Binder> static void bind(Binder& b) {
+ *       b("name", &Person::name);
+ *       b("age", &Person::age);
+ *       b("tags", &Person::tags);
+ *     }
+ *   };
+ * }
+ *
+ * Person person;
+ * bool ok = QJson::fromJson(json, person);
+ * QByteArray out = QJson::toJson(person);
+ * \endcode
+ *
+ * Members can be strings, numbers, booleans, other structs with their own
+ * Fields and QLists of any of these. Other types are supported by
+ * overloading QJson::readValue() and QJson::writeValue() for them.
+ * Unknown keys are skipped and null values leave the member untouched.
+ */
+
+namespace QJson {
+
+  /**
+  * Declares the members of T, see structbinding.h
+  */
+  template <class T> struct Fields;
+
+  // Reading: each readValue() converts the current token of the reader,
+  // returning false if it doesn't have the expected type or range
+
+  inline bool readValue(StreamReader& reader, QString& value)
+  {
+    if (reader.tokenType() != StreamReader::String)
+      return false;
+    value = reader.value().toString();
+    return true;
+  }
+
+  inline bool readValue(StreamReader& reader, bool& value)
+  {
+    if (reader.tokenType() != StreamReader::Bool)
+      return false;
+    value = reader.value().toBool();
+    return true;
+  }
+
+  // Integers are scanned as qulonglong when they aren't negative and as
+  // qlonglong otherwise, numbers with a fraction or an exponent as double.
+  // Only integers within the range of the member are accepted.
+
+  template <class T>
+  bool readSigned(StreamReader& reader, T& value)
+  {
+    if (reader.tokenType() != StreamReader::Number)
+      return false;
+    const QVariant number = reader.value();
+    qlonglong n;
+    if (number.userType() == QMetaType::LongLong)
+      n = number.toLongLong();
+    else if (number.userType() == QMetaType::ULongLong
+             && number.toULongLong() <= qulonglong(std::numeric_limits<T>::max()))
+      n = qlonglong(number.toULongLong());
+    else
+      return false;
+    if (n < qlonglong(std::numeric_limits<T>::min()) || n > qlonglong(std::numeric_limits<T>::max()))
+      return false;
+    value = T(n);
+    return true;
+  }
+
+  template <class T>
+  bool readUnsigned(StreamReader& reader, T& value)
+  {
+    if (reader.tokenType() != StreamReader::Number)
+      return false;
+    const QVariant number = reader.value();
+    if (number.userType() != QMetaType::ULongLong
+        || number.toULongLong() > qulonglong(std::numeric_limits<T>::max()))
+      return false;
+    value = T(number.toULongLong());
+    return true;
+  }
+
+  inline bool readValue(StreamReader& reader, int& value) { return readSigned(reader, value); }
+  inline bool readValue(StreamReader& reader, uint& value) { return readUnsigned(reader, value); }
+  inline bool readValue(StreamReader& reader, qlonglong& value) { return readSigned(reader, value); }
+  inline bool readValue(StreamReader& reader, qulonglong& value) { return readUnsigned(reader, value); }
+
+  inline bool readValue(StreamReader& reader, double& value)
+  {
+    if (reader.tokenType() != StreamReader::Number)
+      return false;
+    value = reader.value().toDouble();
+    return true;
+  }
+
+  template <class T>
+  bool readValue(StreamReader& reader, QList<T>& list)
+  {
+    if (reader.tokenType() != StreamReader::StartArray)
+      return false;
+    list.clear();
+    while (reader.readNext() != StreamReader::EndArray) {
+      T item = T();
+      if (reader.hasError() || !readValue(reader, item))
+        return false;
+      list.append(item);
+    }
+    return true;
+  }
+
+  // Reads the value of the current member into one field of T
+  template <class T>
+  class FieldSlot {
+    public:
+      virtual ~FieldSlot() {}
+      virtual bool read(StreamReader& reader, T& object) const = 0;
+  };
+
+  template <class T, class M>
+  class MemberSlot : public FieldSlot<T> {
+    public:
+      explicit MemberSlot(M T::*member) : m_member(member) {}
+      bool read(StreamReader& reader, T& object) const { return readValue(reader, object.*m_member); }
+
+    private:
+      M T::*m_member;
+  };
+
+  // The fields of T by name, collected from Fields<T> once per type, so
+  // that each key read is a single hash lookup rather than a comparison
+  // with the name of every field. A name declared twice is read into the
+  // first field.
+  template <class T>
+  class FieldTable {
+    public:
+      FieldTable() { Fields<T>::bind(*this); }
+      ~FieldTable() { qDeleteAll(m_fields); }
+
+      template <class M>
+      void operator()(const char* name, M T::*member)
+      {
+        const QString key = QLatin1String(name);
+        if (!m_fields.contains(key))
+          m_fields.insert(key, new MemberSlot<T, M>(member));
+      }
+
+      const FieldSlot<T>* find(const QString& name) const { return m_fields.value(name); }
+
+      // Built on first use, the compiler guards the initialization against
+      // concurrent first uses
+      static const FieldTable& instance()
+      {
+        static const FieldTable table;
+        return table;
+      }
+
+    private:
+      Q_DISABLE_COPY(FieldTable)
+      QHash<QString, const FieldSlot<T>*> m_fields;
+  };
+
+  template <class T>
+  bool readValue(StreamReader& reader, T& object)
+  {
+    if (reader.tokenType() != StreamReader::StartObject)
+      return false;
+    const FieldTable<T>& fields = FieldTable<T>::instance();
+    while (reader.readNext() != StreamReader::EndObject) {
+      if (reader.hasError())
+        return false;
+      const FieldSlot<T>* field = fields.find(reader.name());
+      if (!field)
+        reader.skipCurrentElement();
+      else if (reader.tokenType() != StreamReader::Null && !field->read(reader, object))
+        return false;
+    }
+    return true;
+  }
+
+  // Writing
+
+  inline void writeValue(StreamWriter& writer, const QString& value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, bool value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, int value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, uint value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, qlonglong value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, qulonglong value) { writer.value(value); }
+  inline void writeValue(StreamWriter& writer, double value) { writer.value(value); }
+
+  template <class T>
+  void writeValue(StreamWriter& writer, const QList<T>& list)
+  {
+    writer.beginArray();
+    for (typename QList<T>::const_iterator it = list.constBegin(); it != list.constEnd(); ++it)
+      writeValue(writer, *it);
+    writer.endArray();
+  }
+
+  // Writes each field as an object member
+  template <class T>
+  class FieldWriter {
+    public:
+      FieldWriter(StreamWriter& writer, const T& object)
+        : m_writer(writer), m_object(object) {}
+
+      template <class M>
+      void operator()(const char* name, M T::*member)
+      {
+        m_writer.key(QLatin1String(name));
+        writeValue(m_writer, m_object.*member);
+      }
+
+    private:
+      StreamWriter& m_writer;
+      const T& m_object;
+  };
+
+  template <class T>
+  void writeValue(StreamWriter& writer, const T& object)
+  {
+    writer.beginObject();
+    FieldWriter<T> field(writer, object);
+    Fields<T>::bind(field);
+    writer.endObject();
+  }
+
+  /**
+  * Reads the JSON document \a json into \a object
+  * @param errorString if not null, set to the error message when reading fails
+  * @returns true if the document is well formed and matches the type of \a object
+  */
+  template <class T>
+  bool fromJson(const QByteArray& json, T& object, QString* errorString = 0)
+  {
+    StreamReader reader(json);
+    reader.readNext();
+    reader.readNext();
+    const bool ok = !reader.hasError() && readValue(reader, object)
+                    && reader.readNext() == StreamReader::EndDocument;
+    if (!ok && errorString) {
+      *errorString = reader.hasError() ? reader.errorString()
+                                       : QString(QLatin1String("The document doesn't match the type"));
+    }
+    return ok;
+  }
+
+  /**
+  * Returns the JSON representation of \a object
+  */
+  template <class T>
+  QByteArray toJson(const T& object, IndentMode mode = QJson::IndentNone)
+  {
+    QByteArray json;
+    {
+      StreamWriter writer(&json);
+      writer.setIndentMode(mode);
+      writeValue(writer, object);
+    }
+    return json;
+  }
+}
+
+#endif // QJSON_STRUCTBINDING_H
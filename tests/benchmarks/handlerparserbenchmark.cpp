@@ -0,0 +1,163 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QJson/HandlerParser>
+#include <QJson/Parser>
+#include <QtTest/QTest>
+
+// Adds up what a document of records holds
+struct SumHandler {
+    SumHandler() : keys(0), strings(0), sum(0) {}
+    bool startObject() { return true; }
+    bool endObject() { return true; }
+    bool startArray() { return true; }
+    bool endArray() { return true; }
+    bool key(const QString&) { ++keys; return true; }
+    bool string(const QString& value) { strings += value.size(); return true; }
+    bool integer(qlonglong value) { sum += value; return true; }
+    bool unsignedInteger(qulonglong value) { sum += value; return true; }
+    bool real(double value) { sum += value; return true; }
+    bool boolean(bool value) { sum += value; return true; }
+    bool null() { return true; }
+
+    int keys;
+    int strings;
+    double sum;
+};
+
+// The same, behind the abstract interface a non template parser would
+// dispatch to
+class AbstractHandler {
+    public:
+        virtual ~AbstractHandler() {}
+        virtual bool startObject() = 0;
+        virtual bool endObject() = 0;
+        virtual bool startArray() = 0;
+        virtual bool endArray() = 0;
+        virtual bool key(const QString& name) = 0;
+        virtual bool string(const QString& value) = 0;
+        virtual bool integer(qlonglong value) = 0;
+        virtual bool unsignedInteger(qulonglong value) = 0;
+        virtual bool real(double value) = 0;
+        virtual bool boolean(bool value) = 0;
+        virtual bool null() = 0;
+};
+
+class VirtualSumHandler : public AbstractHandler {
+    public:
+        bool startObject() { return handler.startObject(); }
+        bool endObject() { return handler.endObject(); }
+        bool startArray() { return handler.startArray(); }
+        bool endArray() { return handler.endArray(); }
+        bool key(const QString& name) { return handler.key(name); }
+        bool string(const QString& value) { return handler.string(value); }
+        bool integer(qlonglong value) { return handler.integer(value); }
+        bool unsignedInteger(qulonglong value) { return handler.unsignedInteger(value); }
+        bool real(double value) { return handler.real(value); }
+        bool boolean(bool value) { return handler.boolean(value); }
+        bool null() { return handler.null(); }
+
+        SumHandler handler;
+};
+
+// Forwards to an AbstractHandler, so that each call is a virtual one
+struct VirtualDispatch {
+    explicit VirtualDispatch(AbstractHandler* handler) : handler(handler) {}
+    bool startObject() { return handler->startObject(); }
+    bool endObject() { return handler->endObject(); }
+    bool startArray() { return handler->startArray(); }
+    bool endArray() { return handler->endArray(); }
+    bool key(const QString& name) { return handler->key(name); }
+    bool string(const QString& value) { return handler->string(value); }
+    bool integer(qlonglong value) { return handler->integer(value); }
+    bool unsignedInteger(qulonglong value) { return handler->unsignedInteger(value); }
+    bool real(double value) { return handler->real(value); }
+    bool boolean(bool value) { return handler->boolean(value); }
+    bool null() { return handler->null(); }
+
+    AbstractHandler* handler;
+};
+
+class HandlerParserBenchmark: public QObject {
+    Q_OBJECT
+    private Q_SLOTS:
+        void initTestCase();
+        void templateHandler();
+        void virtualHandler();
+        void variantTree();
+
+    private:
+        QByteArray m_json;
+        double m_sum;
+};
+
+void HandlerParserBenchmark::initTestCase()
+{
+    m_json = "[";
+    for (int i = 0; i < 10000; ++i) {
+        if (i) {
+            m_json += ", ";
+        }
+        m_json += "{\"id\" : " + QByteArray::number(i)
+                + ", \"name\" : \"person " + QByteArray::number(i)
+                + "\", \"score\" : " + QByteArray::number(i * 0.5)
+                + ", \"active\" : " + (i % 2 ? "true" : "false")
+                + ", \"manager\" : null}";
+    }
+    m_json += ']';
+
+    SumHandler handler;
+    QVERIFY(QJson::parse(m_json, handler));
+    QCOMPARE(handler.keys, 50000);
+    m_sum = handler.sum;
+}
+
+void HandlerParserBenchmark::templateHandler()
+{
+    SumHandler handler;
+    QBENCHMARK {
+        handler = SumHandler();
+        QJson::parse(m_json, handler);
+    }
+    QCOMPARE(handler.sum, m_sum);
+}
+
+void HandlerParserBenchmark::virtualHandler()
+{
+    VirtualSumHandler handler;
+    QBENCHMARK {
+        handler.handler = SumHandler();
+        VirtualDispatch dispatch(&handler);
+        QJson::parse(m_json, dispatch);
+    }
+    QCOMPARE(handler.handler.sum, m_sum);
+}
+
+void HandlerParserBenchmark::variantTree()
+{
+    QJson::Parser parser;
+    QVariant result;
+    QBENCHMARK {
+        result = parser.parse(m_json);
+    }
+    QCOMPARE(result.toList().size(), 10000);
+}
+
+QTEST_MAIN(HandlerParserBenchmark)
+
+#include "handlerparserbenchmark.moc"
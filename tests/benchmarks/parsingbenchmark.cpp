@@ -22,13 +22,23 @@
 #include <QJson/Serializer>
 #include <QtTest/QTest>
 #include <QFile>
+#include <QStringList>
 
 class ParsingBenchmark: public QObject {
     Q_OBJECT
     private Q_SLOTS:
         void benchmark();
+        void wideObjects();
+        void wideObjects_data();
+        void wideObjectLookup();
+        void wideObjectLookup_data();
+
+    private:
+        static QByteArray wideObjectsJson();
 };
 
+Q_DECLARE_METATYPE(QJson::Parser::ObjectType)
+
 void ParsingBenchmark::benchmark() {
     QString path = QFINDTESTDATA("largefile.json");
 
@@ -49,6 +59,81 @@ void ParsingBenchmark::benchmark() {
     Q_UNUSED(result);
 }
 
+QByteArray ParsingBenchmark::wideObjectsJson() {
+    QByteArray json = "[";
+    for (int i = 0; i < 10; ++i) {
+        json += i ? ", {" : "{";
+        for (int j = 0; j < 5000; ++j) {
+            if (j) {
+                json += ", ";
+            }
+            json += "\"key" + QByteArray::number(j) + "\" : " + QByteArray::number(i * j);
+        }
+        json += '}';
+    }
+    json += ']';
+    return json;
+}
+
+void ParsingBenchmark::wideObjects_data() {
+    QTest::addColumn<QJson::Parser::ObjectType>("objectType");
+
+    QTest::newRow("map") << QJson::Parser::MapObjects;
+    QTest::newRow("hash") << QJson::Parser::HashObjects;
+}
+
+void ParsingBenchmark::wideObjects() {
+    QFETCH(QJson::Parser::ObjectType, objectType);
+
+    const QByteArray data = wideObjectsJson();
+    QVariant result;
+
+    QJson::Parser parser;
+    parser.setObjectType(objectType);
+    QBENCHMARK {
+        result = parser.parse(data);
+    }
+
+    QCOMPARE(result.toList().size(), 10);
+}
+
+void ParsingBenchmark::wideObjectLookup_data() {
+    wideObjects_data();
+}
+
+void ParsingBenchmark::wideObjectLookup() {
+    QFETCH(QJson::Parser::ObjectType, objectType);
+
+    QJson::Parser parser;
+    parser.setObjectType(objectType);
+    const QVariantList objects = parser.parse(wideObjectsJson()).toList();
+    QCOMPARE(objects.size(), 10);
+
+    QStringList keys;
+    for (int j = 0; j < 5000; j += 7) {
+        keys << QString(QLatin1String("key%1")).arg(j);
+    }
+
+    qlonglong sum = 0;
+    QBENCHMARK {
+        Q_FOREACH (const QVariant& object, objects) {
+            if (objectType == QJson::Parser::HashObjects) {
+                const QVariantHash* hash = static_cast<const QVariantHash*>(object.constData());
+                Q_FOREACH (const QString& key, keys) {
+                    sum += hash->value(key).toLongLong();
+                }
+            } else {
+                const QVariantMap* map = static_cast<const QVariantMap*>(object.constData());
+                Q_FOREACH (const QString& key, keys) {
+                    sum += map->value(key).toLongLong();
+                }
+            }
+        }
+    }
+
+    QVERIFY(sum > 0);
+}
+
 
 QTEST_MAIN(ParsingBenchmark)
 
@@ -0,0 +1,98 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QJson/QObjectHelper>
+#include <QtTest/QTest>
+
+#include "person.h"
+
+using namespace QJson;
+
+class QObjectHelperBenchmark: public QObject {
+    Q_OBJECT
+    private Q_SLOTS:
+        void qobject2qvariant();
+        void qobjects2qvariants();
+        void qvariant2qobject();
+};
+
+void QObjectHelperBenchmark::qobject2qvariant()
+{
+    QList<Person*> people;
+    for (int i = 0; i < 10000; ++i) {
+        Person* person = new Person;
+        person->setName(QString(QLatin1String("person %1")).arg(i));
+        person->setPhoneNumber(i);
+        person->setDob(QDate(1980, 1, 1).addDays(i));
+        people << person;
+    }
+
+    QVariantList result;
+    QBENCHMARK {
+        result.clear();
+        foreach (const Person* person, people) {
+            result << QObjectHelper::qobject2qvariant(person);
+        }
+    }
+    QCOMPARE(result.size(), people.size());
+    qDeleteAll(people);
+}
+
+void QObjectHelperBenchmark::qobjects2qvariants()
+{
+    QList<QObject*> people;
+    for (int i = 0; i < 10000; ++i) {
+        Person* person = new Person;
+        person->setName(QString(QLatin1String("person %1")).arg(i));
+        person->setPhoneNumber(i);
+        person->setDob(QDate(1980, 1, 1).addDays(i));
+        people << person;
+    }
+
+    QVariantList result;
+    QBENCHMARK {
+        result = QObjectHelper::qobjects2qvariants(people);
+    }
+    QCOMPARE(result.size(), people.size());
+    qDeleteAll(people);
+}
+
+void QObjectHelperBenchmark::qvariant2qobject()
+{
+    QVariantList maps;
+    for (int i = 0; i < 10000; ++i) {
+        QVariantMap map;
+        map.insert(QLatin1String("name"), QString(QLatin1String("person %1")).arg(i));
+        map.insert(QLatin1String("phoneNumber"), i);
+        map.insert(QLatin1String("gender"), static_cast<int>(Person::Female));
+        map.insert(QLatin1String("luckyNumber"), 7);
+        maps << map;
+    }
+
+    Person person;
+    QBENCHMARK {
+        foreach (const QVariant& map, maps) {
+            QObjectHelper::qvariant2qobject(map.toMap(), &person);
+        }
+    }
+    QCOMPARE(person.phoneNumber(), 9999);
+}
+
+QTEST_MAIN(QObjectHelperBenchmark)
+
+#include "qobjecthelperbenchmark.moc"
@@ -0,0 +1,168 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QJson/Serializer>
+#include <QtTest/QTest>
+
+Q_DECLARE_METATYPE(QJson::IndentMode)
+
+class SerializingBenchmark: public QObject {
+    Q_OBJECT
+    private Q_SLOTS:
+        void wide();
+        void wide_data();
+        void deep();
+        void deep_data();
+        void numbers();
+        void numbers_data();
+        void sortedKeys();
+        void sortedKeys_data();
+
+    private:
+        void addIndentRows();
+};
+
+static QVariantMap record(int i) {
+    QVariantMap map;
+    map.insert(QLatin1String("id"), i);
+    map.insert(QLatin1String("name"), QString(QLatin1String("record number %1")).arg(i));
+    map.insert(QLatin1String("ratio"), i / 7.0);
+    map.insert(QLatin1String("active"), (i % 2) == 0);
+    map.insert(QLatin1String("tags"), QStringList() << QLatin1String("foo") << QLatin1String("bar"));
+    return map;
+}
+
+void SerializingBenchmark::addIndentRows() {
+    QTest::addColumn<QJson::IndentMode>("indentMode");
+
+    QTest::newRow("none") << QJson::IndentNone;
+    QTest::newRow("compact") << QJson::IndentCompact;
+    QTest::newRow("full") << QJson::IndentFull;
+}
+
+void SerializingBenchmark::wide_data() {
+    addIndentRows();
+}
+
+void SerializingBenchmark::wide() {
+    QFETCH(QJson::IndentMode, indentMode);
+
+    QVariantList list;
+    for (int i = 0; i < 10000; ++i) {
+        list << record(i);
+    }
+
+    QJson::Serializer serializer;
+    serializer.setIndentMode(indentMode);
+
+    QByteArray result;
+    QBENCHMARK {
+        result = serializer.serialize(list);
+    }
+
+    QVERIFY(!result.isEmpty());
+}
+
+void SerializingBenchmark::deep_data() {
+    addIndentRows();
+}
+
+void SerializingBenchmark::deep() {
+    QFETCH(QJson::IndentMode, indentMode);
+
+    QVariant nested = record(0);
+    for (int i = 0; i < 1000; ++i) {
+        QVariantMap map = record(i);
+        map.insert(QLatin1String("child"), nested);
+        nested = map;
+    }
+
+    QJson::Serializer serializer;
+    serializer.setIndentMode(indentMode);
+
+    QByteArray result;
+    QBENCHMARK {
+        result = serializer.serialize(nested);
+    }
+
+    QVERIFY(!result.isEmpty());
+}
+
+void SerializingBenchmark::numbers_data() {
+    QTest::addColumn<int>("precision");
+
+    QTest::newRow("precision 6") << 6;
+    QTest::newRow("precision 17") << 17;
+    QTest::newRow("shortest") << static_cast<int>(QJson::Serializer::ShortestDoublePrecision);
+}
+
+void SerializingBenchmark::numbers() {
+    QFETCH(int, precision);
+
+    QVariantList list;
+    for (int i = 0; i < 100000; ++i) {
+        list << i * 1.1 << qlonglong(i) * 1000003;
+    }
+
+    QJson::Serializer serializer;
+    serializer.setIndentMode(QJson::IndentCompact);
+    serializer.setDoublePrecision(precision);
+
+    QByteArray result;
+    QBENCHMARK {
+        result = serializer.serialize(list);
+    }
+
+    QVERIFY(!result.isEmpty());
+}
+
+void SerializingBenchmark::sortedKeys_data() {
+    QTest::addColumn<bool>("sorted");
+
+    QTest::newRow("hash order") << false;
+    QTest::newRow("sorted") << true;
+}
+
+void SerializingBenchmark::sortedKeys() {
+    QFETCH(bool, sorted);
+
+    QVariantList list;
+    for (int i = 0; i < 1000; ++i) {
+        QVariantHash hash;
+        for (int j = 0; j < 50; ++j) {
+            hash.insert(QString(QLatin1String("key%1")).arg(j), i * j);
+        }
+        list << hash;
+    }
+
+    QJson::Serializer serializer;
+    serializer.setIndentMode(QJson::IndentCompact);
+    serializer.setSortedKeys(sorted);
+
+    QByteArray result;
+    QBENCHMARK {
+        result = serializer.serialize(list);
+    }
+
+    QVERIFY(!result.isEmpty());
+}
+
+
+QTEST_MAIN(SerializingBenchmark)
+
+#include "serializingbenchmark.moc"
@@ -19,7 +19,14 @@
  */
 
 #include <cmath>
+#include <string.h>
 
+#ifdef Q_OS_UNIX
+# include <sys/stat.h>
+#endif
+
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThread>
 #include <QtCore/QVariant>
 
 #include <QtTest/QtTest>
@@ -58,6 +65,21 @@ class TestParser: public QObject
     void testTopLevelValues_data();
     void testReadWrite();
     void testReadWrite_data();
+    void testCancel();
+    void testTimeout();
+    void testProgressCallback();
+    void testLimits();
+    void testLimits_data();
+    void testEndlessString();
+    void testObjectType();
+    void testDuplicateKeyPolicy();
+    void testDuplicateKeyPolicy_data();
+    void testKeyInterning();
+    void testParseFile();
+    void testParseSequentialFile();
+    void testReadBufferSize();
+    void testValidate();
+    void testValidate_data();
 };
 
 Q_DECLARE_METATYPE(QVariant)
@@ -471,6 +493,466 @@ void TestParser::reuseSameParser()
   QVERIFY (ok);
 }
 
+static QByteArray largeArray(int items)
+{
+  QByteArray json = "[";
+  for (int i = 0; i < items; ++i) {
+    json += "{\"id\" : 1234, \"name\" : \"item\"},";
+  }
+  json += "null]";
+  return json;
+}
+
+static void cancelParser(qint64 bytesRead, void* userData)
+{
+  Q_UNUSED(bytesRead);
+  static_cast<Parser*>(userData)->cancel();
+}
+
+void TestParser::testCancel()
+{
+  Parser parser;
+  bool ok;
+
+  parser.setProgressCallback(cancelParser, &parser);
+  parser.parse (largeArray(10000), &ok);
+  QVERIFY (!ok);
+  QCOMPARE(parser.errorString(), QString(QLatin1String("Parsing cancelled")));
+
+  // a new parse operation must not be affected by the previous request
+  parser.setProgressCallback(0);
+  parser.parse (largeArray(10000), &ok);
+  QVERIFY (ok);
+
+  // a request made before parsing cancels the next operation, however
+  // small, and that one only
+  parser.cancel();
+  parser.parse (QByteArray("[1]"), &ok);
+  QVERIFY (!ok);
+  QCOMPARE(parser.errorString(), QString(QLatin1String("Parsing cancelled")));
+  parser.parse (QByteArray("[1]"), &ok);
+  QVERIFY (ok);
+}
+
+static void slowProgress(qint64 bytesRead, void* userData)
+{
+  Q_UNUSED(bytesRead);
+  Q_UNUSED(userData);
+  QTest::qSleep(10);
+}
+
+void TestParser::testTimeout()
+{
+  Parser parser;
+  bool ok;
+
+  QCOMPARE(parser.timeout(), 0);
+  parser.setTimeout(5);
+  QCOMPARE(parser.timeout(), 5);
+
+  parser.setProgressCallback(slowProgress);
+  parser.parse (largeArray(10000), &ok);
+  QVERIFY (!ok);
+  QCOMPARE(parser.errorString(), QString(QLatin1String("Parsing timed out")));
+}
+
+static void recordProgress(qint64 bytesRead, void* userData)
+{
+  QList<qint64>* progress = static_cast<QList<qint64>*>(userData);
+  QVERIFY(progress->isEmpty() || progress->last() < bytesRead);
+  progress->append(bytesRead);
+}
+
+void TestParser::testProgressCallback()
+{
+  QList<qint64> progress;
+  const QByteArray json = largeArray(10000);
+
+  Parser parser;
+  bool ok;
+  parser.setProgressCallback(recordProgress, &progress);
+  parser.parse (json, &ok);
+  QVERIFY (ok);
+  QVERIFY (progress.size() > 1);
+  QCOMPARE(progress.last(), qint64(json.size()));
+}
+
+void TestParser::testLimits()
+{
+  QFETCH(QByteArray, json);
+  QFETCH(int, maxDepth);
+  QFETCH(int, maxDocumentSize);
+  QFETCH(int, maxStringLength);
+  QFETCH(int, maxElementCount);
+  QFETCH(QString, error);
+
+  Parser parser;
+  parser.setMaxDepth(maxDepth);
+  parser.setMaxDocumentSize(maxDocumentSize);
+  parser.setMaxStringLength(maxStringLength);
+  parser.setMaxElementCount(maxElementCount);
+  QCOMPARE(parser.maxDepth(), maxDepth);
+  QCOMPARE(parser.maxDocumentSize(), qint64(maxDocumentSize));
+  QCOMPARE(parser.maxStringLength(), maxStringLength);
+  QCOMPARE(parser.maxElementCount(), maxElementCount);
+
+  bool ok;
+  QVariant result = parser.parse (json, &ok);
+  QCOMPARE(ok, error.isEmpty());
+  QCOMPARE(parser.errorString(), error);
+  if (!ok) {
+    QVERIFY(!result.isValid());
+  }
+
+  // the same data read from a device must give the same outcome
+  QBuffer buffer;
+  buffer.setData(json);
+  result = parser.parse (&buffer, &ok);
+  QCOMPARE(ok, error.isEmpty());
+  QCOMPARE(parser.errorString(), error);
+}
+
+void TestParser::testLimits_data()
+{
+  QTest::addColumn<QByteArray>("json");
+  QTest::addColumn<int>("maxDepth");
+  QTest::addColumn<int>("maxDocumentSize");
+  QTest::addColumn<int>("maxStringLength");
+  QTest::addColumn<int>("maxElementCount");
+  QTest::addColumn<QString>("error");
+
+  const QString depthError = QLatin1String("Maximum depth exceeded");
+  const QString sizeError = QLatin1String("Maximum document size exceeded");
+  const QString stringError = QLatin1String("Maximum string length exceeded");
+  const QString countError = QLatin1String("Maximum element count exceeded");
+
+  QTest::newRow("no limits") << QByteArray("[[{\"key\" : \"value\"}]]") << 0 << 0 << 0 << 0 << QString();
+
+  QTest::newRow("depth at limit") << QByteArray("[[1], {\"a\" : 1}]") << 2 << 0 << 0 << 0 << QString();
+  QTest::newRow("array too deep") << QByteArray("[[[1]]]") << 2 << 0 << 0 << 0 << depthError;
+  QTest::newRow("object too deep") << QByteArray("{\"a\" : {\"b\" : {}}}") << 2 << 0 << 0 << 0 << depthError;
+  QTest::newRow("very deep") << QByteArray(100000, '[') << 64 << 0 << 0 << 0 << depthError;
+
+  QTest::newRow("size at limit") << QByteArray("[1,2]") << 0 << 5 << 0 << 0 << QString();
+  QTest::newRow("document too big") << QByteArray("[1,2,3]") << 0 << 5 << 0 << 0 << sizeError;
+
+  QTest::newRow("string at limit") << QByteArray("[\"abc\"]") << 0 << 0 << 3 << 0 << QString();
+  QTest::newRow("string too long") << QByteArray("[\"abcd\"]") << 0 << 0 << 3 << 0 << stringError;
+  QTest::newRow("escaped string too long") << QByteArray("[\"\\n\\n\\n\\n\"]") << 0 << 0 << 3 << 0 << stringError;
+  QTest::newRow("key too long") << QByteArray("{\"abcd\" : 1}") << 0 << 0 << 3 << 0 << stringError;
+  // rejected as it grows, rather than at the closing quote which never comes
+  QTest::newRow("endless escapes") << QByteArray("[\"").append(QByteArray("\\u0041").repeated(10000)) << 0 << 0 << 10 << 0 << stringError;
+
+  QTest::newRow("elements at limit") << QByteArray("[1,2,3]") << 0 << 0 << 0 << 3 << QString();
+  QTest::newRow("too many elements") << QByteArray("[1,2,3,4]") << 0 << 0 << 0 << 3 << countError;
+  QTest::newRow("too many members") << QByteArray("{\"a\":1,\"b\":2,\"c\":3,\"d\":4}") << 0 << 0 << 0 << 3 << countError;
+  QTest::newRow("nested too many elements") << QByteArray("[[1,2,3,4]]") << 0 << 0 << 0 << 3 << countError;
+}
+
+// An endless string, made of one quote followed by as many characters as
+// are read
+class EndlessStringDevice : public QIODevice
+{
+  public:
+    EndlessStringDevice() : bytesRead(0) { open(QIODevice::ReadOnly); }
+    bool isSequential() const { return true; }
+    qint64 bytesRead;
+
+  protected:
+    qint64 readData(char* data, qint64 maxSize) {
+      memset(data, 'a', maxSize);
+      if (bytesRead == 0 && maxSize > 0)
+        data[0] = '"';
+      bytesRead += maxSize;
+      return maxSize;
+    }
+    qint64 writeData(const char*, qint64) { return -1; }
+};
+
+void TestParser::testEndlessString()
+{
+  Parser parser;
+  parser.setMaxStringLength(1000);
+
+  // the scanner must give up long before buffering the whole string
+  EndlessStringDevice device;
+  bool ok;
+  parser.parse(&device, &ok);
+  QVERIFY(!ok);
+  QCOMPARE(parser.errorString(), QString(QLatin1String("Maximum string length exceeded")));
+  QVERIFY(device.bytesRead < 1024 * 1024);
+}
+
+void TestParser::testObjectType()
+{
+  const QByteArray json = "{ \"foo\" : 1, \"bar\" : { \"baz\" : [ {} ] } }";
+
+  Parser parser;
+  QCOMPARE(parser.objectType(), Parser::MapObjects);
+  bool ok;
+  QVariant result = parser.parse(json, &ok);
+  QVERIFY(ok);
+  QCOMPARE(result.type(), QVariant::Map);
+  QCOMPARE(result.toMap().value(QLatin1String("bar")).type(), QVariant::Map);
+
+  parser.setObjectType(Parser::HashObjects);
+  QCOMPARE(parser.objectType(), Parser::HashObjects);
+  result = parser.parse(json, &ok);
+  QVERIFY(ok);
+  QCOMPARE(result.type(), QVariant::Hash);
+  const QVariantHash hash = result.toHash();
+  QCOMPARE(hash.size(), 2);
+  QCOMPARE(hash.value(QLatin1String("foo")).toInt(), 1);
+  const QVariant bar = hash.value(QLatin1String("bar"));
+  QCOMPARE(bar.type(), QVariant::Hash);
+  const QVariantList baz = bar.toHash().value(QLatin1String("baz")).toList();
+  QCOMPARE(baz.size(), 1);
+  QCOMPARE(baz.first().type(), QVariant::Hash);
+  QVERIFY(baz.first().toHash().isEmpty());
+}
+
+Q_DECLARE_METATYPE(QJson::Parser::DuplicateKeyPolicy)
+Q_DECLARE_METATYPE(QJson::Parser::ObjectType)
+
+void TestParser::testDuplicateKeyPolicy()
+{
+  QFETCH(QJson::Parser::DuplicateKeyPolicy, policy);
+  QFETCH(QJson::Parser::ObjectType, objectType);
+  QFETCH(bool, expectedOk);
+  QFETCH(int, expectedValue);
+
+  const QByteArray json = "{ \"a\" : 1, \"b\" : 2,\n \"a\" : 3 }";
+
+  Parser parser;
+  QCOMPARE(parser.duplicateKeyPolicy(), Parser::LastKeyWins);
+  parser.setDuplicateKeyPolicy(policy);
+  parser.setObjectType(objectType);
+  bool ok;
+  const QVariant result = parser.parse(json, &ok);
+  QCOMPARE(ok, expectedOk);
+  if (ok) {
+    if (objectType == Parser::HashObjects) {
+      QCOMPARE(result.toHash().size(), 2);
+      QCOMPARE(result.toHash().value(QLatin1String("a")).toInt(), expectedValue);
+    } else {
+      QCOMPARE(result.toMap().size(), 2);
+      QCOMPARE(result.toMap().value(QLatin1String("a")).toInt(), expectedValue);
+    }
+  } else {
+    QVERIFY(parser.errorString().contains(QLatin1String("Duplicate key")));
+    QCOMPARE(parser.errorLine(), 2);
+  }
+}
+
+void TestParser::testDuplicateKeyPolicy_data()
+{
+  QTest::addColumn<QJson::Parser::DuplicateKeyPolicy>("policy");
+  QTest::addColumn<QJson::Parser::ObjectType>("objectType");
+  QTest::addColumn<bool>("expectedOk");
+  QTest::addColumn<int>("expectedValue");
+
+  QTest::newRow("last wins") << Parser::LastKeyWins << Parser::MapObjects << true << 3;
+  QTest::newRow("first wins") << Parser::FirstKeyWins << Parser::MapObjects << true << 1;
+  QTest::newRow("error") << Parser::DuplicateKeyError << Parser::MapObjects << false << 0;
+  QTest::newRow("last wins, hash") << Parser::LastKeyWins << Parser::HashObjects << true << 3;
+  QTest::newRow("first wins, hash") << Parser::FirstKeyWins << Parser::HashObjects << true << 1;
+  QTest::newRow("error, hash") << Parser::DuplicateKeyError << Parser::HashObjects << false << 0;
+}
+
+void TestParser::testKeyInterning()
+{
+  const QByteArray json = "[ { \"name\" : 1, \"other\" : 2 }, { \"name\" : 3 } ]";
+
+  Parser parser;
+  QCOMPARE(parser.keyInternTableSize(), 0);
+  bool ok;
+  QVariantList result = parser.parse(json, &ok).toList();
+  QVERIFY(ok);
+  QVERIFY(result.at(0).toMap().constBegin().key().constData() != result.at(1).toMap().constBegin().key().constData());
+
+  // keys are shared within a document and across documents
+  parser.setKeyInternTableSize(1);
+  QCOMPARE(parser.keyInternTableSize(), 1);
+  result = parser.parse(json, &ok).toList();
+  QVERIFY(ok);
+  const QString first = result.at(0).toMap().constBegin().key();
+  QCOMPARE(first, QString(QLatin1String("name")));
+  QVERIFY(first.constData() == result.at(1).toMap().constBegin().key().constData());
+
+  QVariantMap again = parser.parse("{ \"name\" : 4, \"other\" : 5 }", &ok).toMap();
+  QVERIFY(ok);
+  QVERIFY(again.constBegin().key().constData() == first.constData());
+  // the table is full, so "other" isn't shared
+  QVERIFY((again.constBegin() + 1).key().constData() != (result.at(0).toMap().constBegin() + 1).key().constData());
+  QCOMPARE(again.value(QLatin1String("other")).toInt(), 5);
+
+  parser.clearKeyInternTable();
+  again = parser.parse("{ \"name\" : 4 }", &ok).toMap();
+  QVERIFY(ok);
+  QVERIFY(again.constBegin().key().constData() != first.constData());
+}
+
+void TestParser::testParseFile() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.write("{\r\n  \"foo\" : [ 1, 2, 3 ],\r\n  \"bar\" : \"baz\"\r\n}\r\n");
+  file.close();
+
+  Parser parser;
+  bool ok;
+  QVariantMap result = parser.parseFile(file.fileName(), &ok).toMap();
+  QVERIFY(ok);
+  QCOMPARE(result.value(QLatin1String("foo")).toList().size(), 3);
+  QCOMPARE(result.value(QLatin1String("bar")).toString(), QString(QLatin1String("baz")));
+
+  // CRLF line breaks count as one line
+  QVERIFY(file.open());
+  file.resize(0);
+  file.write("{\r\n  \"foo\" : ]\r\n}");
+  file.close();
+  parser.parseFile(file.fileName(), &ok);
+  QVERIFY(!ok);
+  QCOMPARE(parser.errorLine(), 2);
+
+  QVERIFY(file.open());
+  file.resize(0);
+  file.close();
+  parser.parseFile(file.fileName(), &ok);
+  QVERIFY(!ok);
+  QCOMPARE(parser.errorString(), QString(QLatin1String("No data")));
+
+  parser.parseFile(file.fileName() + QLatin1String(".missing"), &ok);
+  QVERIFY(!ok);
+  QVERIFY(!parser.errorString().isEmpty());
+}
+
+#ifdef Q_OS_UNIX
+// Writes data to a FIFO, opening it blocks until the other end is opened
+class FifoWriter : public QThread
+{
+  public:
+    FifoWriter(const QString& path, const QByteArray& data) : m_path(path), m_data(data) {}
+
+  protected:
+    void run() {
+      QFile fifo(m_path);
+      if (fifo.open(QIODevice::WriteOnly))
+        fifo.write(m_data);
+    }
+
+  private:
+    QString m_path;
+    QByteArray m_data;
+};
+#endif
+
+void TestParser::testParseSequentialFile() {
+#ifdef Q_OS_UNIX
+  // a FIFO has no size, it must be read rather than rejected as empty
+  QString path;
+  {
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    path = file.fileName() + QLatin1String(".fifo");
+  }
+  QVERIFY(mkfifo(QFile::encodeName(path).constData(), 0600) == 0);
+
+  FifoWriter writer(path, "{ \"foo\" : [ 1, 2, 3 ] }");
+  writer.start();
+
+  Parser parser;
+  bool ok;
+  QVariantMap result = parser.parseFile(path, &ok).toMap();
+  writer.wait();
+  QFile::remove(path);
+  QVERIFY(ok);
+  QCOMPARE(result.value(QLatin1String("foo")).toList().size(), 3);
+#endif
+}
+
+void TestParser::testReadBufferSize() {
+  // a document many times the buffer size, with tokens longer than the buffer
+  QByteArray json = "[";
+  for (int i = 0; i < 1000; ++i) {
+    if (i > 0)
+      json += ",\n";
+    json += "{ \"key\" : \"" + QByteArray(i % 100, 'x') + "\", \"value\" : " + QByteArray::number(i) + " }";
+  }
+  json += "]";
+
+  Parser parser;
+  QCOMPARE(parser.readBufferSize(), 0);
+  bool ok;
+  const QVariant expected = parser.parse(json, &ok);
+  QVERIFY(ok);
+
+  parser.setReadBufferSize(16);
+  QCOMPARE(parser.readBufferSize(), 16);
+  QBuffer buffer;
+  buffer.setData(json);
+  const QVariant result = parser.parse(&buffer, &ok);
+  QVERIFY(ok);
+  QCOMPARE(result, expected);
+  QCOMPARE(result.toList().size(), 1000);
+
+  // errors are still reported on the right line
+  buffer.setData(json + "\n]");
+  parser.parse(&buffer, &ok);
+  QVERIFY(!ok);
+  QCOMPARE(parser.errorLine(), 1001);
+}
+
+void TestParser::testValidate() {
+  QFETCH(QByteArray, json);
+  QFETCH(int, maxStringLength);
+  QFETCH(int, maxElementCount);
+
+  Parser parser;
+  parser.setMaxStringLength(maxStringLength);
+  parser.setMaxElementCount(maxElementCount);
+
+  // validating must always agree with parsing
+  bool ok;
+  parser.parse(json, &ok);
+  const QString error = parser.errorString();
+  const int errorLine = parser.errorLine();
+
+  QCOMPARE(parser.validate(json), ok);
+  QCOMPARE(parser.errorString(), error);
+  QCOMPARE(parser.errorLine(), errorLine);
+
+  QBuffer buffer;
+  buffer.setData(json);
+  QCOMPARE(parser.validate(&buffer), ok);
+  QCOMPARE(parser.errorString(), error);
+
+  // validation doesn't leave the parser in validating mode
+  if (ok)
+    QVERIFY(parser.parse(json).isValid());
+}
+
+void TestParser::testValidate_data() {
+  QTest::addColumn<QByteArray>("json");
+  QTest::addColumn<int>("maxStringLength");
+  QTest::addColumn<int>("maxElementCount");
+
+  QTest::newRow("object") << QByteArray("{ \"foo\" : [ 1, 2.5, true, null, \"bar\" ], \"baz\" : {} }") << 0 << 0;
+  QTest::newRow("escapes") << QByteArray("[ \"a\\\"b\\n\\u00e9\\u20AC\" ]") << 0 << 0;
+  QTest::newRow("large exponent") << QByteArray("[ 1.5e300, -2E-300 ]") << 0 << 0;
+  QTest::newRow("double out of range") << QByteArray("[ 1,\n 1e999 ]") << 0 << 0;
+  QTest::newRow("integer out of range") << QByteArray("[ 18446744073709551616 ]") << 0 << 0;
+  QTest::newRow("missing comma") << QByteArray("{ \"foo\" : 1\n \"bar\" : 2 }") << 0 << 0;
+  QTest::newRow("unterminated string") << QByteArray("[ \"foo ]") << 0 << 0;
+  QTest::newRow("invalid hex") << QByteArray("[ \"\\u00zz\" ]") << 0 << 0;
+  QTest::newRow("string at limit") << QByteArray("[ \"\xc3\xa9t\xc3\xa9\" ]") << 3 << 0;
+  QTest::newRow("string too long") << QByteArray("[ \"\xc3\xa9t\xc3\xa9s\" ]") << 3 << 0;
+  QTest::newRow("surrogate pair at limit") << QByteArray("[ \"\xf0\x9d\x84\x9e\" ]") << 2 << 0;
+  QTest::newRow("escapes too long") << QByteArray("[ \"\\n\\t\\u0041\\\\\" ]") << 3 << 0;
+  QTest::newRow("elements at limit") << QByteArray("[ [ 1, 2 ], { \"a\" : 1, \"b\" : 2 } ]") << 0 << 2;
+  QTest::newRow("too many elements") << QByteArray("[ 1, 2,\n 3 ]") << 0 << 2;
+  QTest::newRow("too many members") << QByteArray("{ \"a\" : 1, \"b\" : 2,\n \"c\" : 3 }") << 0 << 2;
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5,0,0)
 // using Qt4 rather then Qt5
 QTEST_MAIN(TestParser)
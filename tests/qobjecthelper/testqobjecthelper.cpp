@@ -21,6 +21,9 @@
 
 #include <limits>
 
+#include <QtCore/QBuffer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <QtCore/QVariant>
 #include <QtCore/QVariantList>
 
@@ -32,16 +35,142 @@
 
 #include "person.h"
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+class Point
+{
+  Q_GADGET
+  Q_PROPERTY(int x READ x WRITE setX)
+  Q_PROPERTY(int y READ y WRITE setY)
+  Q_PROPERTY(QString label READ label WRITE setLabel)
+
+  public:
+    Point() : m_x(0), m_y(0) {}
+
+    int x() const { return m_x; }
+    void setX(int x) { m_x = x; }
+    int y() const { return m_y; }
+    void setY(int y) { m_y = y; }
+    QString label() const { return m_label; }
+    void setLabel(const QString& label) { m_label = label; }
+
+  private:
+    int m_x;
+    int m_y;
+    QString m_label;
+};
+#endif
+
+// Redeclares a property of its base class
+class Employee : public Person
+{
+  Q_OBJECT
+  Q_PROPERTY(QString name READ name WRITE setName)
+};
+
+// Points to another object, possibly to itself
+class Node : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(QObject* next READ next)
+
+  public:
+    Node() : m_next(0) {}
+    QObject* next() const { return m_next; }
+    QObject* m_next;
+};
+
+// Holds an object through a pointer to its subclass rather than QObject*
+class Team : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(Person* leader READ leader)
+  Q_PROPERTY(Person* deputy READ deputy)
+
+  public:
+    Team() : m_leader(new Person(this)) {}
+    Person* leader() const { return m_leader; }
+    Person* deputy() const { return 0; }
+
+  private:
+    Person* m_leader;
+};
+
+// Notifies the changes of its value, and remembers which threads it was
+// accessed from
+class Counter : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int value READ value WRITE setValue NOTIFY valueChanged)
+
+  public:
+    Counter() : m_value(0), m_offThread(false) {}
+    int value() const {
+      m_offThread = m_offThread || QThread::currentThread() != thread();
+      return m_value;
+    }
+    void setValue(int value) {
+      m_offThread = m_offThread || QThread::currentThread() != thread();
+      m_value = value;
+      emit valueChanged(value);
+    }
+    bool accessedOffThread() const { return m_offThread; }
+
+  Q_SIGNALS:
+    void valueChanged(int value);
+
+  private:
+    int m_value;
+    mutable bool m_offThread;
+};
+
+// Counts the notifications it gets, and those it gets from another thread
+class CounterListener : public QObject
+{
+  Q_OBJECT
+
+  public:
+    CounterListener() : notifications(0), offThread(0) {}
+    int notifications;
+    int offThread;
+
+  public Q_SLOTS:
+    void valueChanged() {
+      ++notifications;
+      if (QThread::currentThread() != thread())
+        ++offThread;
+    }
+};
+
 class TestQObjectHelper: public QObject
 {
   Q_OBJECT
   private slots:
     void testQObject2QVariant();
     void testQVariant2QObject();
+    void testCachedTables();
+    void testSerializeQObject();
+    void testSerializeRedeclaredProperty();
+    void testSerializeCycle();
+    void testJson2QObject();
+    void testJson2QObjects();
+    void testGadget();
+    void testBulkConversion();
+    void testBulkConversionThreads();
 };
 
 using namespace QJson;
 
+class PersonFactory : public ObjectFactory
+{
+  public:
+    ~PersonFactory() { qDeleteAll(people); }
+    QObject* create() {
+      people << new Person;
+      return people.last();
+    }
+    QList<Person*> people;
+};
+
 void TestQObjectHelper::testQObject2QVariant()
 {
   QString name = QLatin1String("Flavio Castelli");
@@ -116,6 +245,301 @@ void TestQObjectHelper::testQVariant2QObject()
   QCOMPARE(person.luckyNumber(), luckyNumber);
 }
 
+void TestQObjectHelper::testCachedTables()
+{
+  // the property table built for the first object serves the others
+  Person first;
+  first.setName(QLatin1String("first"));
+  Person second;
+  second.setName(QLatin1String("second"));
+  second.setPhoneNumber(42);
+
+  QCOMPARE(QObjectHelper::qobject2qvariant(&first).value(QLatin1String("name")).toString(), QString(QLatin1String("first")));
+  QVariantMap result = QObjectHelper::qobject2qvariant(&second);
+  QCOMPARE(result.value(QLatin1String("name")).toString(), QString(QLatin1String("second")));
+  QCOMPARE(result.value(QLatin1String("phoneNumber")).toInt(), 42);
+
+  // the ignored properties are still decided per call
+  result = QObjectHelper::qobject2qvariant(&second, QStringList() << QLatin1String("name") << QLatin1String("dob"));
+  QVERIFY(!result.contains(QLatin1String("name")));
+  QVERIFY(!result.contains(QLatin1String("dob")));
+  QVERIFY(result.contains(QLatin1String("objectName")));
+  QVERIFY(result.contains(QLatin1String("phoneNumber")));
+
+  QVariantMap values;
+  values.insert(QLatin1String("phoneNumber"), QLatin1String("7"));
+  values.insert(QLatin1String("unknown"), 1);
+  QObjectHelper::qvariant2qobject(values, &first);
+  QCOMPARE(first.phoneNumber(), 7);
+
+  // and without the cache, the properties are looked up on every call
+  QVERIFY(QObjectHelper::isPropertyTableCacheEnabled());
+  QObjectHelper::setPropertyTableCacheEnabled(false);
+  QVERIFY(!QObjectHelper::isPropertyTableCacheEnabled());
+  values.insert(QLatin1String("phoneNumber"), 8);
+  QObjectHelper::qvariant2qobject(values, &first);
+  QCOMPARE(first.phoneNumber(), 8);
+  QCOMPARE(QObjectHelper::qobject2qvariant(&second).value(QLatin1String("phoneNumber")).toInt(), 42);
+  Serializer serializer;
+  bool ok;
+  QVERIFY(serializer.serialize(&first, &ok).contains("\"phoneNumber\" : 8"));
+  QVERIFY(ok);
+  QObjectHelper::setPropertyTableCacheEnabled(true);
+}
+
+void TestQObjectHelper::testSerializeQObject()
+{
+  bool ok;
+  Person person;
+  person.setName(QLatin1String("Flavio Castelli"));
+  person.setPhoneNumber(123456);
+  person.setGender(Person::Male);
+  person.setDob(QDate(1982, 7, 12));
+  person.setCustomField(QVariantList() << QLatin1String("nickname1") << 2);
+  person.setLuckyNumber(123);
+
+  // written directly, the properties come out as through a QVariantMap
+  Serializer serializer;
+  const QByteArray json = serializer.serialize(&person, &ok);
+  QVERIFY(ok);
+  const QByteArray expected = serializer.serialize(QObjectHelper::qobject2qvariant(&person), &ok);
+  QVERIFY(ok);
+
+  Parser parser;
+  const QVariantMap result = parser.parse(json, &ok).toMap();
+  QVERIFY(ok);
+  QCOMPARE(result, parser.parse(expected, &ok).toMap());
+  QVERIFY(!result.contains(QLatin1String("objectName")));
+
+  // lists of objects, ignoring other properties
+  Person other;
+  other.setName(QLatin1String("other"));
+  QList<QObject*> people;
+  people << &person << &other;
+  serializer.setIgnoredProperties(QStringList() << QLatin1String("dob") << QLatin1String("customField"));
+  QCOMPARE(serializer.ignoredProperties(), QStringList() << QLatin1String("dob") << QLatin1String("customField"));
+  const QVariantList list = parser.parse(serializer.serialize(people, &ok), &ok).toList();
+  QVERIFY(ok);
+  QCOMPARE(list.size(), 2);
+  QCOMPARE(list.at(1).toMap().value(QLatin1String("name")).toString(), QString(QLatin1String("other")));
+  QVERIFY(list.at(0).toMap().contains(QLatin1String("objectName")));
+  QVERIFY(!list.at(0).toMap().contains(QLatin1String("dob")));
+  QVERIFY(!list.at(1).toMap().contains(QLatin1String("customField")));
+
+  QVERIFY(serializer.serialize(static_cast<const QObject*>(0), &ok).isNull());
+  QVERIFY(!ok);
+  QVERIFY(!serializer.errorMessage().isEmpty());
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+  // objects held through a subclass pointer are written as nested objects
+  Team team;
+  team.leader()->setName(QLatin1String("Ann"));
+  const QVariantMap teamResult = parser.parse(serializer.serialize(&team, &ok), &ok).toMap();
+  QVERIFY(ok);
+  QCOMPARE(teamResult.value(QLatin1String("leader")).toMap().value(QLatin1String("name")).toString(), QString(QLatin1String("Ann")));
+  QVERIFY(teamResult.contains(QLatin1String("deputy")));
+  QVERIFY(!teamResult.value(QLatin1String("deputy")).isValid());
+#endif
+}
+
+void TestQObjectHelper::testSerializeRedeclaredProperty()
+{
+  Employee employee;
+  employee.setName(QLatin1String("Alice"));
+
+  Serializer serializer;
+  serializer.setIndentMode(QJson::IndentCompact);
+  bool ok;
+  const QByteArray json = serializer.serialize(&employee, &ok);
+  QVERIFY(ok);
+  QCOMPARE(json.count("\"name\""), 1);
+}
+
+void TestQObjectHelper::testSerializeCycle()
+{
+  Node first;
+  Node second;
+  first.m_next = &second;
+
+  Serializer serializer;
+  serializer.setIndentMode(QJson::IndentCompact);
+  bool ok;
+  QCOMPARE(serializer.serialize(&first, &ok), QByteArray("{\"next\":{\"next\":null}}"));
+  QVERIFY(ok);
+
+  // a cycle is an error rather than endless output
+  second.m_next = &first;
+  QVERIFY(serializer.serialize(&first, &ok).isNull());
+  QVERIFY(!ok);
+  QVERIFY(!serializer.errorMessage().isEmpty());
+}
+
+void TestQObjectHelper::testJson2QObject()
+{
+  const QByteArray json(
+    "{ \"unknown\" : { \"nested\" : [ 1, { \"name\" : \"wrong\" } ] }, \"name\" : \"Flavio Castelli\","
+    "  \"phoneNumber\" : 123456, \"gender\" : 0, \"dob\" : \"1982-07-12\","
+    "  \"customField\" : [ \"nickname1\", { \"a\" : [ true ] } ], \"luckyNumber\" : 123 }");
+
+  Person person;
+  QString error;
+  QVERIFY(QObjectHelper::json2qobject(json, &person, &error));
+  QVERIFY(error.isEmpty());
+
+  // the same as going through a QVariantMap
+  Person expected;
+  bool ok;
+  Parser parser;
+  QObjectHelper::qvariant2qobject(parser.parse(json, &ok).toMap(), &expected);
+  QVERIFY(ok);
+  QCOMPARE(person.name(), QString(QLatin1String("Flavio Castelli")));
+  QCOMPARE(person.phoneNumber(), 123456);
+  QCOMPARE(person.gender(), Person::Male);
+  QCOMPARE(person.dob(), QDate(1982, 7, 12));
+  QCOMPARE(person.customField(), expected.customField());
+  QCOMPARE(person.luckyNumber(), quint16(123));
+
+  QBuffer buffer;
+  buffer.setData("{ \"name\" : \"from a device\" }");
+  QVERIFY(QObjectHelper::json2qobject(&buffer, &person));
+  QCOMPARE(person.name(), QString(QLatin1String("from a device")));
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+  // objects are read into the properties holding a subclass pointer too
+  Team team;
+  QVERIFY(QObjectHelper::json2qobject(QByteArray("{ \"leader\" : { \"name\" : \"Ann\", \"phoneNumber\" : 5 } }"), &team, &error));
+  QCOMPARE(team.leader()->name(), QString(QLatin1String("Ann")));
+  QCOMPARE(team.leader()->phoneNumber(), 5);
+#endif
+
+  QVERIFY(!QObjectHelper::json2qobject(QByteArray("[ 1 ]"), &person, &error));
+  QVERIFY(!error.isEmpty());
+  QVERIFY(!QObjectHelper::json2qobject(QByteArray("{ \"name\" : \"x\" "), &person, &error));
+  QVERIFY(!error.isEmpty());
+}
+
+void TestQObjectHelper::testJson2QObjects()
+{
+  const QByteArray json(
+    "[ { \"name\" : \"first\", \"phoneNumber\" : 1 },"
+    "  { \"name\" : \"second\", \"extra\" : null },"
+    "  {} ]");
+
+  PersonFactory factory;
+  QString error;
+  QVERIFY(QObjectHelper::json2qobjects(json, &factory, &error));
+  QCOMPARE(factory.people.size(), 3);
+  QCOMPARE(factory.people.at(0)->name(), QString(QLatin1String("first")));
+  QCOMPARE(factory.people.at(0)->phoneNumber(), 1);
+  QCOMPARE(factory.people.at(1)->name(), QString(QLatin1String("second")));
+  QVERIFY(factory.people.at(2)->name().isEmpty());
+
+  PersonFactory other;
+  QVERIFY(!QObjectHelper::json2qobjects(QByteArray("[ {}, 2 ]"), &other, &error));
+  QVERIFY(!error.isEmpty());
+  QVERIFY(!QObjectHelper::json2qobjects(QByteArray("{}"), &other, &error));
+}
+
+void TestQObjectHelper::testGadget()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+  Point point;
+  point.setX(3);
+  point.setY(-4);
+  point.setLabel(QLatin1String("corner"));
+
+  QVariantMap expected;
+  expected[QLatin1String("x")] = 3;
+  expected[QLatin1String("y")] = -4;
+  expected[QLatin1String("label")] = QLatin1String("corner");
+  QCOMPARE(QObjectHelper::qgadget2qvariant(point), expected);
+
+  QVariantMap result = QObjectHelper::qgadget2qvariant(point, QStringList() << QLatin1String("label"));
+  QVERIFY(!result.contains(QLatin1String("label")));
+  QCOMPARE(result.size(), 2);
+
+  QVariantMap values;
+  values.insert(QLatin1String("x"), QLatin1String("7"));
+  values.insert(QLatin1String("label"), QLatin1String("moved"));
+  values.insert(QLatin1String("unknown"), 1);
+  QObjectHelper::qvariant2qgadget(values, point);
+  QCOMPARE(point.x(), 7);
+  QCOMPARE(point.y(), -4);
+  QCOMPARE(point.label(), QString(QLatin1String("moved")));
+#endif
+}
+
+void TestQObjectHelper::testBulkConversion()
+{
+  // enough objects to be split among several threads
+  QList<QObject*> people;
+  for (int i = 0; i < 1000; ++i) {
+    Person* person = new Person;
+    person->setName(QString(QLatin1String("person %1")).arg(i));
+    person->setPhoneNumber(i);
+    people << person;
+  }
+  people << 0;
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(4);
+  const QVariantList result = QObjectHelper::qobjects2qvariants(people, QStringList() << QLatin1String("dob"), &pool);
+  QCOMPARE(result.size(), people.size());
+  for (int i = 0; i < 1000; ++i) {
+    QCOMPARE(result.at(i).toMap(), QObjectHelper::qobject2qvariant(people.at(i), QStringList() << QLatin1String("dob")));
+  }
+  QVERIFY(!result.last().isValid());
+
+  // and back, to other objects
+  QList<QObject*> copies;
+  for (int i = 0; i < 1000; ++i) {
+    copies << new Person;
+  }
+  QObjectHelper::qvariants2qobjects(result, copies);
+  for (int i = 0; i < 1000; ++i) {
+    QCOMPARE(static_cast<Person*>(copies.at(i))->name(), static_cast<Person*>(people.at(i))->name());
+    QCOMPARE(static_cast<Person*>(copies.at(i))->phoneNumber(), i);
+  }
+
+  qDeleteAll(people);
+  qDeleteAll(copies);
+}
+
+void TestQObjectHelper::testBulkConversionThreads()
+{
+  // enough objects to be split among several threads, whose properties
+  // must all the same be accessed from their own thread only
+  CounterListener listener;
+  QList<QObject*> counters;
+  for (int i = 0; i < 1000; ++i) {
+    Counter* counter = new Counter;
+    counter->setValue(i);
+    connect(counter, SIGNAL(valueChanged(int)), &listener, SLOT(valueChanged()), Qt::DirectConnection);
+    counters << counter;
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(4);
+  QVariantList values = QObjectHelper::qobjects2qvariants(counters, QStringList() << QLatin1String("objectName"), &pool);
+  for (int i = 0; i < 1000; ++i) {
+    QCOMPARE(values.at(i).toMap().value(QLatin1String("value")).toInt(), i);
+    QVariantMap value;
+    value.insert(QLatin1String("value"), QString::number(2 * i));
+    values[i] = value;
+  }
+
+  QObjectHelper::qvariants2qobjects(values, counters, &pool);
+  QCOMPARE(listener.notifications, 1000);
+  QCOMPARE(listener.offThread, 0);
+  for (int i = 0; i < 1000; ++i) {
+    Counter* counter = static_cast<Counter*>(counters.at(i));
+    QCOMPARE(counter->value(), 2 * i);
+    QVERIFY(!counter->accessedOffThread());
+  }
+
+  qDeleteAll(counters);
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5,0,0)
 // using Qt4 rather then Qt5
 QTEST_MAIN(TestQObjectHelper)
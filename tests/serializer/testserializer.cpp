@@ -40,11 +40,15 @@ class TestSerializer: public QObject
     void testValueStringList();
     void testValueStringList_data();
     void testValueHashMap();
+    void testSortedKeys();
+    void testValueContainers();
     void testValueInteger();
     void testValueInteger_data();
     void testValueDouble();
     void testValueDouble_data();
     void testSetDoublePrecision();
+    void testShortestDoublePrecision();
+    void testShortestDoublePrecision_data();
     void testValueFloat();
     void testValueFloat_data();
     void testValueBoolean();
@@ -57,6 +61,10 @@ class TestSerializer: public QObject
     void testSerializeWithoutOkParam();
     void testEscapeChars();
     void testEscapeChars_data();
+    void testUtf8Output();
+    void testUtf8Output_data();
+    void testMaxDepth();
+    void testDeepNesting();
 
   private:
     void valueTest( const QVariant& value, const QString& expectedRegExp, bool errorExpected = false );
@@ -358,6 +366,68 @@ void TestSerializer::testValueStringList_data()
   QTest::newRow( "simple QStringList" ) << QVariant( stringlist) << expected;
 }
 
+void TestSerializer::testSortedKeys()
+{
+  QVariantHash inner;
+  inner.insert( QLatin1String( "zeta" ), 1 );
+  inner.insert( QLatin1String( "alpha" ), 2 );
+  QVariantMap innerMap;
+  innerMap.insert( QLatin1String( "zeta" ), 1 );
+  innerMap.insert( QLatin1String( "alpha" ), 2 );
+  QVariantHash hash;
+  for ( int i = 20; i > 0; --i ) {
+    hash.insert( QString::number( i ), i );
+  }
+  hash.insert( QLatin1String( "inner" ), inner );
+
+  // a QVariantMap with the same contents is always ordered
+  QVariantMap map;
+  for ( QVariantHash::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it ) {
+    map.insert( it.key(), it.value() );
+  }
+  map.insert( QLatin1String( "inner" ), innerMap );
+
+  Serializer serializer;
+  QVERIFY( !serializer.sortedKeys() );
+  serializer.setSortedKeys( true );
+  QVERIFY( serializer.sortedKeys() );
+
+  bool ok;
+  const QByteArray sorted = serializer.serialize( hash, &ok );
+  QVERIFY( ok );
+  QCOMPARE( sorted, serializer.serialize( map, &ok ) );
+  QVERIFY( sorted.contains( "{ \"alpha\" : 2, \"zeta\" : 1 }" ) );
+}
+
+void TestSerializer::testValueContainers()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+  Serializer serializer;
+  bool ok;
+
+  QList<int> numbers;
+  numbers << 1 << 2 << 3;
+  QCOMPARE( serializer.serialize( QVariant::fromValue( numbers ), &ok ), QByteArray( "[ 1, 2, 3 ]" ) );
+  QVERIFY( ok );
+
+  QVector<QString> strings;
+  strings << QLatin1String( "foo" ) << QLatin1String( "bar" );
+  QCOMPARE( serializer.serialize( QVariant::fromValue( strings ), &ok ), QByteArray( "[ \"foo\", \"bar\" ]" ) );
+  QVERIFY( ok );
+
+  QMap<QString, int> map;
+  map.insert( QLatin1String( "a" ), 1 );
+  map.insert( QLatin1String( "b" ), 2 );
+  QCOMPARE( serializer.serialize( QVariant::fromValue( map ), &ok ), QByteArray( "{ \"a\" : 1, \"b\" : 2 }" ) );
+  QVERIFY( ok );
+
+  QVariantList nested;
+  nested << QVariant::fromValue( numbers ) << QVariant( QStringList() << QLatin1String( "x" ) );
+  QCOMPARE( serializer.serialize( nested, &ok ), QByteArray( "[ [ 1, 2, 3 ], [ \"x\" ] ]" ) );
+  QVERIFY( ok );
+#endif
+}
+
 void TestSerializer::testValueInteger()
 {
   QFETCH( QVariant, value );
@@ -465,6 +535,50 @@ void TestSerializer::testSetDoublePrecision()
           .arg( expected ).arg( actualUnicode ) ) );
 }
 
+void TestSerializer::testShortestDoublePrecision()
+{
+  QFETCH( double, value );
+  QFETCH( QByteArray, expected );
+
+  Serializer serializer;
+  serializer.setDoublePrecision(Serializer::ShortestDoublePrecision);
+  bool ok;
+  const QByteArray actual = serializer.serialize( QVariant(value), &ok);
+  QVERIFY(ok);
+  QCOMPARE(actual, expected);
+
+  // the output must read back as exactly the same number
+  Parser parser;
+  const QVariant reparsed = parser.parse( actual, &ok );
+  QVERIFY(ok);
+  QCOMPARE(reparsed.type(), QVariant::Double);
+  QVERIFY(reparsed.toDouble() == value);
+}
+
+void TestSerializer::testShortestDoublePrecision_data()
+{
+  QTest::addColumn<double>( "value" );
+  QTest::addColumn<QByteArray>( "expected" );
+
+  QTest::newRow( "zero" ) << 0.0 << QByteArray( "0.0" );
+  QTest::newRow( "integral" ) << 100.0 << QByteArray( "100.0" );
+  QTest::newRow( "one tenth" ) << 0.1 << QByteArray( "0.1" );
+  QTest::newRow( "sum of tenths" ) << 0.1 + 0.2 << QByteArray( "0.30000000000000004" );
+  QTest::newRow( "eight digits" ) << 0.12345678 << QByteArray( "0.12345678" );
+  QTest::newRow( "negative" ) << -2.5 << QByteArray( "-2.5" );
+  QTest::newRow( "small" ) << 0.000001 << QByteArray( "0.000001" );
+  QTest::newRow( "smaller" ) << 1e-7 << QByteArray( "1e-7" );
+  QTest::newRow( "large" ) << 1e21 << QByteArray( "1e+21" );
+  QTest::newRow( "max" ) << std::numeric_limits<double>::max() << QByteArray( "1.7976931348623157e+308" );
+  QTest::newRow( "min" ) << std::numeric_limits<double>::min() << QByteArray( "2.2250738585072014e-308" );
+  // the last digit of these is found past the tenth fractional digit of
+  // the scaled value, and must still be the closest one
+  QTest::newRow( "closest last digit, integral" ) << -218470626061754150.0 << QByteArray( "-218470626061754140.0" );
+  QTest::newRow( "closest last digit, fraction" ) << 1.0903743148420288 << QByteArray( "1.0903743148420288" );
+  QTest::newRow( "closest last digit, small" ) << 2.1805483275354613e-35 << QByteArray( "2.1805483275354613e-35" );
+  QTest::newRow( "closest last digit, large" ) << 2.1829489720880483e+41 << QByteArray( "2.1829489720880483e+41" );
+}
+
 void TestSerializer::testValueFloat()
 {
   QFETCH( QVariant, value );
@@ -637,6 +751,94 @@ void TestSerializer::testEscapeChars_data()
     QTest::newRow("non-ASCII unicode char") << QString(unicodeSnowman) << "\\u2603";
 
     QTest::newRow("control chars") << QString(QChar(0x06)) << "\\u0006";
+
+    // long enough to be scanned in blocks, with escapes straddling them
+    QTest::newRow("long ASCII string") << "abcdefghijklmnopqrstuvwxyz0123456789" << "abcdefghijklmnopqrstuvwxyz0123456789";
+    QTest::newRow("escapes inside long string") << "abcdefg\"hijklmno\npqrstuvwxyz\\" << "abcdefg\\\"hijklmno\\npqrstuvwxyz\\\\";
+    QTest::newRow("non-ASCII inside long string") << QString(QLatin1String("abcdefghij")) + QChar(0x00e9) + QLatin1String("klmnopq") + QChar(0xd83d) + QChar(0xde00)
+      << "abcdefghij\\u00e9klmnopq\\ud83d\\ude00";
+}
+
+void TestSerializer::testUtf8Output()
+{
+    QFETCH(QString, input);
+    QFETCH(QByteArray, expected);
+
+    Serializer serializer;
+    QVERIFY(serializer.escapeNonAscii());
+    serializer.setEscapeNonAscii(false);
+    QVERIFY(!serializer.escapeNonAscii());
+
+    bool ok;
+    QByteArray json = serializer.serialize(QVariant(QVariantList() << input), &ok);
+    QVERIFY(ok);
+    QCOMPARE(json, "[ \"" + expected + "\" ]");
+
+    Parser parser;
+    QVariant reparsed = parser.parse(json, &ok);
+    QVERIFY(ok);
+    QCOMPARE(reparsed.toList().first().toString(), input);
+}
+
+void TestSerializer::testUtf8Output_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QByteArray>("expected");
+
+    QTest::newRow("ASCII") << QString(QLatin1String("input")) << QByteArray("input");
+    QTest::newRow("escapes are kept") << QString(QLatin1String("a\"b\\c\n")) << QByteArray("a\\\"b\\\\c\\n");
+    QTest::newRow("two byte sequence") << QString(QChar(0x00e9)) << QByteArray("\xc3\xa9");
+    QTest::newRow("three byte sequence") << QString(QChar(0x2603)) << QByteArray("\xe2\x98\x83");
+    QTest::newRow("surrogate pair") << (QString(QChar(0xd83d)) + QChar(0xde00)) << QByteArray("\xf0\x9f\x98\x80");
+    QTest::newRow("mixed text") << (QString(QLatin1String("caf")) + QChar(0x00e9) + QLatin1String(" au lait, ") + QChar(0x043a) + QChar(0x043e) + QChar(0x0444) + QChar(0x0435))
+      << QByteArray("caf\xc3\xa9 au lait, \xd0\xba\xd0\xbe\xd1\x84\xd0\xb5");
+}
+
+void TestSerializer::testMaxDepth()
+{
+  QVariantMap inner;
+  inner.insert(QLatin1String("list"), QVariantList() << 1 << 2);
+  QVariantList outer;
+  outer << QVariant(inner);
+
+  Serializer serializer;
+  bool ok;
+  QCOMPARE(serializer.maxDepth(), 0);
+
+  serializer.setMaxDepth(3);
+  QCOMPARE(serializer.maxDepth(), 3);
+  QByteArray json = serializer.serialize(outer, &ok);
+  QVERIFY(ok);
+  QCOMPARE(json, QByteArray("[ { \"list\" : [ 1, 2 ] } ]"));
+
+  serializer.setMaxDepth(2);
+  json = serializer.serialize(outer, &ok);
+  QVERIFY(!ok);
+  QVERIFY(json.isNull());
+  QVERIFY(!serializer.errorMessage().isEmpty());
+}
+
+void TestSerializer::testDeepNesting()
+{
+  const int depth = 100000;
+  QVariant nested(1);
+  for (int i = 0; i < depth; ++i) {
+    nested = QVariantList() << nested;
+  }
+
+  Serializer serializer;
+  serializer.setIndentMode(QJson::IndentCompact);
+  bool ok;
+  const QByteArray json = serializer.serialize(nested, &ok);
+  QVERIFY(ok);
+  QCOMPARE(json, QByteArray(depth, '[') + '1' + QByteArray(depth, ']'));
+
+  // tear the document down one level at a time, QVariant's destructor would
+  // recurse as deep as the document does
+  while (nested.type() == QVariant::List) {
+    const QVariant inner = nested.toList().first();
+    nested = inner;
+  }
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5,0,0)
@@ -0,0 +1,249 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QtCore/QBuffer>
+#include <QtCore/QStringList>
+#include <QtCore/QVariant>
+
+#include <QtTest/QtTest>
+
+#include <QJson/HandlerParser>
+#include <QJson/StreamReader>
+
+using QJson::StreamReader;
+
+class TestStreamReader: public QObject
+{
+  Q_OBJECT
+  private slots:
+    void testTokens();
+    void testDevice();
+    void testSkipCurrentElement();
+    void testInvalid();
+    void testInvalid_data();
+    void testHandler();
+    void testHandlerAbort();
+};
+
+// Describes every token of the document, one per entry
+static QStringList readAll(StreamReader& reader)
+{
+  QStringList tokens;
+  while (!reader.atEnd()) {
+    StreamReader::TokenType type = reader.readNext();
+    QString token = QString::number(type);
+    if (!reader.name().isEmpty())
+      token += QLatin1Char(' ') + reader.name();
+    if (reader.value().isValid())
+      token += QLatin1Char('=') + reader.value().toString();
+    tokens << token;
+  }
+  return tokens;
+}
+
+static QString token(StreamReader::TokenType type, const char* name = 0, const char* value = 0)
+{
+  QString result = QString::number(type);
+  if (name)
+    result += QLatin1Char(' ') + QLatin1String(name);
+  if (value)
+    result += QLatin1Char('=') + QLatin1String(value);
+  return result;
+}
+
+void TestStreamReader::testTokens()
+{
+  StreamReader reader(QByteArray("{ \"a\" : [ 1, \"two\", 3.5 ],\n"
+                                 "  \"b\" : { \"c\" : true, \"d\" : null },\n"
+                                 "  \"e\" : [], \"f\" : {} }"));
+  QCOMPARE(reader.tokenType(), StreamReader::NoToken);
+
+  const QStringList expected = QStringList()
+    << token(StreamReader::StartDocument)
+    << token(StreamReader::StartObject)
+    << token(StreamReader::StartArray, "a")
+    << token(StreamReader::Number, 0, "1")
+    << token(StreamReader::String, 0, "two")
+    << token(StreamReader::Number, 0, "3.5")
+    << token(StreamReader::EndArray)
+    << token(StreamReader::StartObject, "b")
+    << token(StreamReader::Bool, "c", "true")
+    << token(StreamReader::Null, "d")
+    << token(StreamReader::EndObject)
+    << token(StreamReader::StartArray, "e")
+    << token(StreamReader::EndArray)
+    << token(StreamReader::StartObject, "f")
+    << token(StreamReader::EndObject)
+    << token(StreamReader::EndObject)
+    << token(StreamReader::EndDocument);
+  QCOMPARE(readAll(reader), expected);
+  QVERIFY(!reader.hasError());
+
+  // the end is sticky
+  QCOMPARE(reader.readNext(), StreamReader::EndDocument);
+}
+
+void TestStreamReader::testDevice()
+{
+  QBuffer buffer;
+  buffer.setData("[ \"foo\", -12 ]");
+
+  StreamReader reader(&buffer);
+  const QStringList expected = QStringList()
+    << token(StreamReader::StartDocument)
+    << token(StreamReader::StartArray)
+    << token(StreamReader::String, 0, "foo")
+    << token(StreamReader::Number, 0, "-12")
+    << token(StreamReader::EndArray)
+    << token(StreamReader::EndDocument);
+  QCOMPARE(readAll(reader), expected);
+  QVERIFY(buffer.isOpen());
+}
+
+void TestStreamReader::testSkipCurrentElement()
+{
+  StreamReader reader(QByteArray("{ \"skip\" : { \"x\" : [ 1, { \"y\" : [] } ], \"z\" : \"zz\" },"
+                                 "  \"keep\" : 42, \"last\" : [ [ 1 ], 2 ] }"));
+  QCOMPARE(reader.readNext(), StreamReader::StartDocument);
+  QCOMPARE(reader.readNext(), StreamReader::StartObject);
+  QCOMPARE(reader.readNext(), StreamReader::StartObject);
+  QCOMPARE(reader.name(), QString(QLatin1String("skip")));
+  reader.skipCurrentElement();
+  QCOMPARE(reader.tokenType(), StreamReader::EndObject);
+
+  QCOMPARE(reader.readNext(), StreamReader::Number);
+  QCOMPARE(reader.name(), QString(QLatin1String("keep")));
+  QCOMPARE(reader.value().toInt(), 42);
+
+  // skipping a scalar does nothing
+  reader.skipCurrentElement();
+  QCOMPARE(reader.tokenType(), StreamReader::Number);
+
+  QCOMPARE(reader.readNext(), StreamReader::StartArray);
+  QCOMPARE(reader.name(), QString(QLatin1String("last")));
+  QCOMPARE(reader.readNext(), StreamReader::StartArray);
+  reader.skipCurrentElement();
+  QCOMPARE(reader.tokenType(), StreamReader::EndArray);
+  QCOMPARE(reader.readNext(), StreamReader::Number);
+  QCOMPARE(reader.value().toInt(), 2);
+  QCOMPARE(reader.readNext(), StreamReader::EndArray);
+  QCOMPARE(reader.readNext(), StreamReader::EndObject);
+  QCOMPARE(reader.readNext(), StreamReader::EndDocument);
+  QVERIFY(!reader.hasError());
+}
+
+// Records the calls it receives, stops at the key "stop"
+struct RecordingHandler {
+  QStringList calls;
+
+  bool startObject() { calls << QLatin1String("{"); return true; }
+  bool endObject() { calls << QLatin1String("}"); return true; }
+  bool startArray() { calls << QLatin1String("["); return true; }
+  bool endArray() { calls << QLatin1String("]"); return true; }
+  bool key(const QString& name) {
+    calls << QLatin1String("key ") + name;
+    return name != QLatin1String("stop");
+  }
+  bool string(const QString& value) { calls << QLatin1String("string ") + value; return true; }
+  bool integer(qlonglong value) { calls << QLatin1String("integer ") + QString::number(value); return true; }
+  bool unsignedInteger(qulonglong value) { calls << QLatin1String("unsigned ") + QString::number(value); return true; }
+  bool real(double value) { calls << QLatin1String("real ") + QString::number(value); return true; }
+  bool boolean(bool value) { calls << (value ? QLatin1String("true") : QLatin1String("false")); return true; }
+  bool null() { calls << QLatin1String("null"); return true; }
+};
+
+void TestStreamReader::testHandler()
+{
+  RecordingHandler handler;
+  QString error;
+  QVERIFY(QJson::parse(QByteArray("{ \"a\" : [ 1, -2, 18446744073709551614, 2.5, \"s\", false, null ],"
+                                  "  \"\" : {}, \"b\" : [ [] ] }"), handler, &error));
+  QVERIFY(error.isEmpty());
+
+  const QStringList expected = QStringList()
+    << QLatin1String("{")
+    << QLatin1String("key a") << QLatin1String("[")
+    << QLatin1String("integer 1") << QLatin1String("integer -2")
+    << QLatin1String("unsigned 18446744073709551614") << QLatin1String("real 2.5")
+    << QLatin1String("string s") << QLatin1String("false") << QLatin1String("null")
+    << QLatin1String("]")
+    << QLatin1String("key ") << QLatin1String("{") << QLatin1String("}")
+    << QLatin1String("key b") << QLatin1String("[") << QLatin1String("[") << QLatin1String("]") << QLatin1String("]")
+    << QLatin1String("}");
+  QCOMPARE(handler.calls, expected);
+
+  // syntax errors are reported like the reader does
+  RecordingHandler invalid;
+  int line = 0;
+  QVERIFY(!QJson::parse(QByteArray("[ 1,\n 2,\n ]"), invalid, &error, &line));
+  QVERIFY(!error.isEmpty());
+  QCOMPARE(line, 3);
+}
+
+void TestStreamReader::testHandlerAbort()
+{
+  RecordingHandler handler;
+  QString error;
+  QBuffer buffer;
+  buffer.setData("{ \"a\" : 1, \"stop\" : 2, \"c\" : 3 }");
+  QVERIFY(!QJson::parse(&buffer, handler, &error));
+  QVERIFY(!error.isEmpty());
+  QCOMPARE(handler.calls.last(), QString(QLatin1String("key stop")));
+  QCOMPARE(handler.calls.size(), 4);
+}
+
+void TestStreamReader::testInvalid()
+{
+  QFETCH(QByteArray, json);
+  QFETCH(int, errorLine);
+
+  StreamReader reader(json);
+  const QStringList tokens = readAll(reader);
+  QCOMPARE(tokens.last(), token(StreamReader::Invalid));
+  QVERIFY(reader.hasError());
+  QVERIFY(!reader.errorString().isEmpty());
+  QCOMPARE(reader.errorLine(), errorLine);
+
+  // the error is sticky
+  QCOMPARE(reader.readNext(), StreamReader::Invalid);
+}
+
+void TestStreamReader::testInvalid_data()
+{
+  QTest::addColumn<QByteArray>("json");
+  QTest::addColumn<int>("errorLine");
+
+  QTest::newRow("empty") << QByteArray("") << 1;
+  QTest::newRow("missing comma") << QByteArray("[ 1\n 2 ]") << 2;
+  QTest::newRow("trailing comma") << QByteArray("[ 1,\n ]") << 2;
+  QTest::newRow("missing colon") << QByteArray("{ \"a\" 1 }") << 1;
+  QTest::newRow("key not a string") << QByteArray("{ 1 : 1 }") << 1;
+  QTest::newRow("mismatched bracket") << QByteArray("[ 1 }") << 1;
+  QTest::newRow("unterminated") << QByteArray("[ 1,\n [ 2 ]") << 2;
+  QTest::newRow("trailing data") << QByteArray("[]\n[]") << 2;
+  QTest::newRow("invalid token") << QByteArray("[ tru ]") << 1;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5,0,0)
+// using Qt4 rather then Qt5
+QTEST_MAIN(TestStreamReader)
+#include "moc_teststreamreader.cxx"
+#else
+QTEST_GUILESS_MAIN(TestStreamReader)
+#include "teststreamreader.moc"
+#endif
@@ -0,0 +1,237 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <limits>
+
+#include <QtCore/QBuffer>
+#include <QtCore/QVariant>
+
+#include <QtTest/QtTest>
+
+#include <QJson/Serializer>
+#include <QJson/StreamWriter>
+
+using QJson::StreamWriter;
+
+class TestStreamWriter: public QObject
+{
+  Q_OBJECT
+  private slots:
+    void testSameAsSerializer();
+    void testSameAsSerializer_data();
+    void testDevice();
+    void testWriteError();
+    void testSpecialNumbers();
+    void testMisuse();
+    void testMisuse_data();
+};
+
+Q_DECLARE_METATYPE(QJson::IndentMode)
+
+void TestStreamWriter::testSameAsSerializer()
+{
+  QFETCH(QJson::IndentMode, indentMode);
+
+  // keys are written in order, so that the map gives the same output
+  QVariantMap inner;
+  inner.insert(QLatin1String("empty array"), QVariantList());
+  inner.insert(QLatin1String("empty object"), QVariantMap());
+  inner.insert(QLatin1String("nothing"), QVariant());
+
+  QVariantList list;
+  list << 1 << -2ll << 3.25 << true << QString::fromUtf8("caf\xc3\xa9 \"quoted\"") << QVariant(inner);
+
+  QVariantMap document;
+  document.insert(QLatin1String("a list"), list);
+  document.insert(QLatin1String("big"), std::numeric_limits<qulonglong>::max());
+  document.insert(QLatin1String("nested"), QVariantList() << QVariant(QVariantList() << 1 << 2) << QVariant(QVariantList()));
+
+  QJson::Serializer serializer;
+  serializer.setIndentMode(indentMode);
+  const QByteArray expected = serializer.serialize(document);
+
+  QByteArray json;
+  StreamWriter writer(&json);
+  writer.setIndentMode(indentMode);
+  QCOMPARE(writer.indentMode(), indentMode);
+  writer.beginObject();
+  writer.key(QLatin1String("a list"));
+  writer.beginArray();
+  writer.value(1);
+  writer.value(-2ll);
+  writer.value(3.25);
+  writer.value(true);
+  writer.value("caf\xc3\xa9 \"quoted\"");
+  writer.beginObject();
+  writer.key(QLatin1String("empty array"));
+  writer.beginArray();
+  writer.endArray();
+  writer.key(QLatin1String("empty object"));
+  writer.beginObject();
+  writer.endObject();
+  writer.key(QLatin1String("nothing"));
+  writer.nullValue();
+  writer.endObject();
+  writer.endArray();
+  writer.key(QLatin1String("big"));
+  writer.value(std::numeric_limits<qulonglong>::max());
+  writer.key(QLatin1String("nested"));
+  writer.beginArray();
+  writer.beginArray();
+  writer.value(1);
+  writer.value(2);
+  writer.endArray();
+  writer.beginArray();
+  writer.endArray();
+  writer.endArray();
+  writer.endObject();
+
+  QVERIFY(!writer.hasError());
+  QCOMPARE(json, expected);
+}
+
+void TestStreamWriter::testSameAsSerializer_data()
+{
+  QTest::addColumn<QJson::IndentMode>("indentMode");
+
+  QTest::newRow("none") << QJson::IndentNone;
+  QTest::newRow("compact") << QJson::IndentCompact;
+  QTest::newRow("minimum") << QJson::IndentMinimum;
+  QTest::newRow("medium") << QJson::IndentMedium;
+  QTest::newRow("full") << QJson::IndentFull;
+}
+
+void TestStreamWriter::testDevice()
+{
+  QBuffer buffer;
+  {
+    StreamWriter writer(&buffer);
+    writer.setIndentMode(QJson::IndentCompact);
+    writer.beginArray();
+    for (int i = 0; i < 10000; ++i) {
+      writer.value(i);
+    }
+    writer.endArray();
+    QVERIFY(!writer.hasError());
+  }
+
+  QVariantList expected;
+  for (int i = 0; i < 10000; ++i) {
+    expected << i;
+  }
+  QJson::Serializer serializer;
+  serializer.setIndentMode(QJson::IndentCompact);
+  QCOMPARE(buffer.data(), serializer.serialize(expected));
+}
+
+// A device which accepts no data
+class FullDevice : public QIODevice
+{
+  public:
+    FullDevice() { open(QIODevice::WriteOnly); }
+
+  protected:
+    qint64 readData(char*, qint64) { return -1; }
+    qint64 writeData(const char*, qint64) { return -1; }
+};
+
+void TestStreamWriter::testWriteError()
+{
+  FullDevice device;
+  StreamWriter writer(&device);
+  writer.beginArray();
+  writer.value(1);
+  writer.endArray();
+  QVERIFY(!writer.hasError());
+
+  writer.flush();
+  QVERIFY(writer.hasError());
+  QVERIFY(!writer.errorString().isEmpty());
+
+  // failing while buffers fill up
+  FullDevice bigDevice;
+  StreamWriter bigWriter(&bigDevice);
+  bigWriter.beginArray();
+  for (int i = 0; i < 100000 && !bigWriter.hasError(); ++i) {
+    bigWriter.value(i);
+  }
+  QVERIFY(bigWriter.hasError());
+}
+
+void TestStreamWriter::testSpecialNumbers()
+{
+  QByteArray json;
+  StreamWriter writer(&json);
+  writer.setIndentMode(QJson::IndentCompact);
+  writer.allowSpecialNumbers(true);
+  writer.beginArray();
+  writer.value(std::numeric_limits<double>::quiet_NaN());
+  writer.value(-std::numeric_limits<double>::infinity());
+  writer.endArray();
+  QVERIFY(!writer.hasError());
+  QCOMPARE(json, QByteArray("[NaN,-Infinity]"));
+
+  QByteArray rejected;
+  StreamWriter strictWriter(&rejected);
+  strictWriter.beginArray();
+  strictWriter.value(std::numeric_limits<double>::infinity());
+  QVERIFY(strictWriter.hasError());
+  QVERIFY(!strictWriter.errorString().isEmpty());
+}
+
+void TestStreamWriter::testMisuse()
+{
+  QFETCH(QString, calls);
+
+  QByteArray json;
+  StreamWriter writer(&json);
+  foreach (const QChar& call, calls) {
+    switch (call.toLatin1()) {
+      case '[': writer.beginArray(); break;
+      case ']': writer.endArray(); break;
+      case '{': writer.beginObject(); break;
+      case '}': writer.endObject(); break;
+      case 'k': writer.key(QLatin1String("key")); break;
+      case 'v': writer.value(1); break;
+    }
+  }
+  QVERIFY(writer.hasError());
+  QVERIFY(!writer.errorString().isEmpty());
+}
+
+void TestStreamWriter::testMisuse_data()
+{
+  QTest::addColumn<QString>("calls");
+
+  QTest::newRow("value without key") << QString(QLatin1String("{v"));
+  QTest::newRow("key in array") << QString(QLatin1String("[k"));
+  QTest::newRow("two keys") << QString(QLatin1String("{kk"));
+  QTest::newRow("key without value") << QString(QLatin1String("{k}"));
+  QTest::newRow("mismatched end") << QString(QLatin1String("[}"));
+  QTest::newRow("end without begin") << QString(QLatin1String("]"));
+  QTest::newRow("two top-level values") << QString(QLatin1String("vv"));
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5,0,0)
+// using Qt4 rather then Qt5
+QTEST_MAIN(TestStreamWriter)
+#include "moc_teststreamwriter.cxx"
+#else
+QTEST_GUILESS_MAIN(TestStreamWriter)
+#include "teststreamwriter.moc"
+#endif
@@ -0,0 +1,172 @@
+/* This file is part of QJson
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software Foundation.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <QtCore/QVariant>
+
+#include <QtTest/QtTest>
+
+#include <QJson/Parser>
+#include <QJson/StructBinding>
+
+struct Address {
+  QString city;
+  uint zip;
+
+  Address() : zip(0) {}
+};
+
+struct Person {
+  QString name;
+  int age;
+  double score;
+  bool active;
+  qlonglong id;
+  QList<QString> tags;
+  Address address;
+  QList<Address> previous;
+
+  Person() : age(0), score(0), active(false), id(0) {}
+};
+
+namespace QJson {
+  template <> struct Fields<Address> {
+    template <class Binder> static void bind(Binder& b) {
+      b("city", &Address::city);
+      b("zip", &Address::zip);
+    }
+  };
+
+  template <> struct Fields<Person> {
+    template <class Binder> static void bind(Binder& b) {
+      b("name", &Person::name);
+      b("age", &Person::age);
+      b("score", &Person::score);
+      b("active", &Person::active);
+      b("id", &Person::id);
+      b("tags", &Person::tags);
+      b("address", &Person::address);
+      b("previous", &Person::previous);
+    }
+  };
+}
+
+class TestStructBinding: public QObject
+{
+  Q_OBJECT
+  private slots:
+    void testFromJson();
+    void testToJson();
+    void testMismatch();
+    void testMismatch_data();
+};
+
+void TestStructBinding::testFromJson()
+{
+  const QByteArray json(
+    "{ \"name\" : \"Alice\", \"age\" : 32, \"score\" : 4.5, \"active\" : true,"
+    "  \"id\" : -9000000000, \"tags\" : [ \"a\", \"b\" ], \"unknown\" : { \"x\" : [ 1, 2 ] },"
+    "  \"address\" : { \"city\" : \"Rome\", \"zip\" : 100 },"
+    "  \"previous\" : [ { \"city\" : \"Milan\" }, { \"zip\" : 20100, \"city\" : null } ] }");
+
+  Person person;
+  QString error;
+  QVERIFY(QJson::fromJson(json, person, &error));
+  QVERIFY(error.isEmpty());
+  QCOMPARE(person.name, QString(QLatin1String("Alice")));
+  QCOMPARE(person.age, 32);
+  QCOMPARE(person.score, 4.5);
+  QCOMPARE(person.active, true);
+  QCOMPARE(person.id, Q_INT64_C(-9000000000));
+  QCOMPARE(person.tags, QList<QString>() << QLatin1String("a") << QLatin1String("b"));
+  QCOMPARE(person.address.city, QString(QLatin1String("Rome")));
+  QCOMPARE(person.address.zip, 100u);
+  QCOMPARE(person.previous.size(), 2);
+  QCOMPARE(person.previous.at(0).city, QString(QLatin1String("Milan")));
+  QCOMPARE(person.previous.at(0).zip, 0u);
+  QVERIFY(person.previous.at(1).city.isEmpty());
+  QCOMPARE(person.previous.at(1).zip, 20100u);
+}
+
+void TestStructBinding::testToJson()
+{
+  Person person;
+  person.name = QLatin1String("Bob");
+  person.age = 40;
+  person.score = 0.5;
+  person.active = false;
+  person.id = 7;
+  person.tags << QLatin1String("x");
+  person.address.city = QLatin1String("Paris");
+  person.address.zip = 75001;
+  person.previous << person.address;
+
+  const QByteArray json = QJson::toJson(person, QJson::IndentCompact);
+  QCOMPARE(json, QByteArray("{\"name\":\"Bob\",\"age\":40,\"score\":0.5,\"active\":false,\"id\":7,"
+                            "\"tags\":[\"x\"],\"address\":{\"city\":\"Paris\",\"zip\":75001},"
+                            "\"previous\":[{\"city\":\"Paris\",\"zip\":75001}]}"));
+
+  // what is written reads back the same
+  Person copy;
+  QVERIFY(QJson::fromJson(json, copy));
+  QCOMPARE(QJson::toJson(copy, QJson::IndentCompact), json);
+
+  // and is valid JSON
+  QJson::Parser parser;
+  bool ok;
+  parser.parse(json, &ok);
+  QVERIFY(ok);
+}
+
+void TestStructBinding::testMismatch()
+{
+  QFETCH(QByteArray, json);
+
+  Person person;
+  QString error;
+  QVERIFY(!QJson::fromJson(json, person, &error));
+  QVERIFY(!error.isEmpty());
+}
+
+void TestStructBinding::testMismatch_data()
+{
+  QTest::addColumn<QByteArray>("json");
+
+  QTest::newRow("not an object") << QByteArray("[ 1 ]");
+  QTest::newRow("string for number") << QByteArray("{ \"age\" : \"old\" }");
+  QTest::newRow("number for string") << QByteArray("{ \"name\" : 1 }");
+  QTest::newRow("int overflow") << QByteArray("{ \"age\" : 10000000000 }");
+  QTest::newRow("int underflow") << QByteArray("{ \"age\" : -10000000000 }");
+  QTest::newRow("exponent for int") << QByteArray("{ \"age\" : 1e10 }");
+  QTest::newRow("fraction for int") << QByteArray("{ \"age\" : 1.5 }");
+  QTest::newRow("negative for unsigned") << QByteArray("{ \"address\" : { \"zip\" : -1 } }");
+  QTest::newRow("qlonglong overflow") << QByteArray("{ \"id\" : 9223372036854775808 }");
+  QTest::newRow("object for list") << QByteArray("{ \"tags\" : {} }");
+  QTest::newRow("wrong element") << QByteArray("{ \"tags\" : [ \"a\", 2 ] }");
+  QTest::newRow("nested mismatch") << QByteArray("{ \"address\" : { \"zip\" : true } }");
+  QTest::newRow("syntax error") << QByteArray("{ \"name\" : \"a\" ");
+  QTest::newRow("trailing data") << QByteArray("{} {}");
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5,0,0)
+// using Qt4 rather then Qt5
+QTEST_MAIN(TestStructBinding)
+#include "moc_teststructbinding.cxx"
+#else
+QTEST_GUILESS_MAIN(TestStructBinding)
+#include "teststructbinding.moc"
+#endif